@@ -13,7 +13,7 @@ constexpr size_t JSIZE = 5000;
 int main(int argc, char *argv[]) {
   mpi::MPIContext Ctx(&argc, &argv);
 
-  std::vector<double> a;
+  mpi::Buffer<double> a;
 
   if (mpi::commRank() == 0) {
     a.resize(ISIZE * JSIZE);
@@ -22,18 +22,19 @@ int main(int argc, char *argv[]) {
         a[i * JSIZE + j] = 10 * i + j;
   }
 
-  auto chunk = mpi::scatterFair(a, ISIZE * JSIZE, 0);
+  /* root keeps its part in a, so it is neither copied nor allocated twice */
+  auto chunk = mpi::scatterFairInPlace(a, ISIZE * JSIZE, 0);
 
   mpi::Timer tmr;
   std::transform(chunk.begin(), chunk.end(), chunk.begin(),
                  [](double v) { return sin(2 * v); });
 
-  if (auto res = mpi::gatherv(chunk)) {
+  if (mpi::gatherFairInPlace(a, ISIZE * JSIZE, 0)) {
     std::cerr << tmr.getElapsedTimeInSeconds() << std::endl;
 #if SAVE_DATA
     std::ofstream os;
     os.open("output.txt");
-    for (double v : res.data())
+    for (double v : a)
       os << v << '\n';
 #endif
   }
@@ -0,0 +1,200 @@
+/* All-to-all exchange
+ *
+ * Each process sends a separate block to every process (itself included),
+ * which is the core of distributed transposes, redistributions between
+ * decompositions and bucket-based distributed sorting.
+ *
+ * Example (spread array held by the first 2 processes over all of them):
+ * util::WorkSplitterLinear From{N, 2}, To{N, Size};
+ * auto Layout =
+ *     cxxmpi::AlltoallvLayout::redistribution(From, To, Rank, Size);
+ * std::vector<double> Mine = cxxmpi::alltoallv<double>(Local, Layout);
+ *
+ * Example (send bucket i to process i):
+ * std::vector<std::vector<int>> Buckets(Size);
+ * for (int X : Keys)
+ *   Buckets[ownerOf(X)].push_back(X);
+ * auto Received = cxxmpi::exchangeBuckets(Buckets);
+ */
+
+#pragma once
+
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+#include "../Util/WorkSplitter.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <vector>
+
+namespace cxxmpi {
+namespace detail {
+
+inline int getAlltoallCount(size_t count) {
+  assert(fitsInt(count) && "All-to-all exchange of more than INT_MAX "
+                           "elements is not supported");
+  return static_cast<int>(count);
+}
+
+inline std::vector<int> getAlltoallDisplacements(ArrayRef<int> counts) {
+  std::vector<int> displs(counts.size());
+  size_t total = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    displs[i] = getAlltoallCount(total);
+    total += counts[i];
+  }
+  getAlltoallCount(total);
+  return displs;
+}
+
+} // namespace detail
+
+/* Counts and displacements of alltoallv(), i-th entries describe the block
+ * sent to (received from) process i */
+struct AlltoallvLayout {
+  std::vector<int> send_counts;
+  std::vector<int> send_displs;
+  std::vector<int> recv_counts;
+  std::vector<int> recv_displs;
+
+  size_t getSendSize() const {
+    return std::accumulate(send_counts.begin(), send_counts.end(), size_t{0});
+  }
+  size_t getRecvSize() const {
+    return std::accumulate(recv_counts.begin(), recv_counts.end(), size_t{0});
+  }
+
+  /* Collective: every process learns how much it receives from others.
+   * Blocks are packed in rank order on both sides */
+  static AlltoallvLayout fromSendCounts(std::vector<int> send_counts,
+                                        const Comm &comm = MPI_COMM_WORLD) {
+    assert(send_counts.size() == static_cast<size_t>(comm.size()) &&
+           "counts must be specified for each process");
+    AlltoallvLayout res;
+    res.send_counts = std::move(send_counts);
+    res.recv_counts.resize(res.send_counts.size());
+    detail::exitOnError(MPI_Alltoall(res.send_counts.data(), 1, MPI_INT,
+                                     res.recv_counts.data(), 1, MPI_INT,
+                                     comm));
+    res.send_displs = detail::getAlltoallDisplacements(res.send_counts);
+    res.recv_displs = detail::getAlltoallDisplacements(res.recv_counts);
+    return res;
+  }
+
+  /* Array distributed by splitter from is redistributed by splitter to,
+   * e.g. to change the number of processes holding it. Splitters may have
+   * fewer workers than num_processes, the rest hold nothing. Everyone knows
+   * the layout, so nothing is communicated */
+  static AlltoallvLayout
+  redistribution(const util::WorkSplitterLinear &from,
+                 const util::WorkSplitterLinear &to, int rank,
+                 int num_processes) {
+    assert(from.getWorkSize() == to.getWorkSize() &&
+           "splitters must split the same work");
+    assert(from.getNumWorkers() <= num_processes &&
+           to.getNumWorkers() <= num_processes && "too many workers");
+    auto range = [](const util::WorkSplitterLinear &splitter, int i) {
+      return i < splitter.getNumWorkers() ? splitter.getRange(i)
+                                          : util::WorkRangeLinear{0, 0};
+    };
+    auto overlap = [](util::WorkRangeLinear a, util::WorkRangeLinear b) {
+      return std::max(0, std::min(a.LastIdx, b.LastIdx) -
+                             std::max(a.FirstIdx, b.FirstIdx));
+    };
+
+    AlltoallvLayout res;
+    auto my_from = range(from, rank);
+    auto my_to = range(to, rank);
+    for (int i = 0; i < num_processes; ++i) {
+      res.send_counts.push_back(overlap(my_from, range(to, i)));
+      res.recv_counts.push_back(overlap(my_to, range(from, i)));
+    }
+    res.send_displs = detail::getAlltoallDisplacements(res.send_counts);
+    res.recv_displs = detail::getAlltoallDisplacements(res.recv_counts);
+    return res;
+  }
+};
+
+/* i-th block of data goes to process i, i-th block of result comes from
+ * it. data and result consist of commSize() blocks of the same size */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+void alltoall(detail::type_identity_t<ArrayRef<ScalarT>> data,
+              MutableArrayRef<ScalarT> result,
+              const Comm &comm = MPI_COMM_WORLD) {
+  size_t comm_sz = comm.size();
+  assert(data.size() == result.size() && data.size() % comm_sz == 0 &&
+         "data and result must consist of a block per process");
+  auto type = TypeSelector::getHandle();
+  int count = detail::getAlltoallCount(data.size() / comm_sz);
+  detail::exitOnError(MPI_Alltoall(data.data(), count, type, result.data(),
+                                   count, type, comm));
+}
+
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+std::vector<ScalarT> alltoall(ArrayRef<ScalarT> data,
+                              const Comm &comm = MPI_COMM_WORLD) {
+  std::vector<ScalarT> result(data.size());
+  alltoall<ScalarT, TypeSelector>(data, MutableArrayRef<ScalarT>(result),
+                                  comm);
+  return result;
+}
+
+/* Blocks of different sizes, placed according to layout. result must have
+ * room for all received blocks */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+void alltoallv(detail::type_identity_t<ArrayRef<ScalarT>> data,
+               const AlltoallvLayout &layout, MutableArrayRef<ScalarT> result,
+               const Comm &comm = MPI_COMM_WORLD) {
+  assert(layout.send_counts.size() == static_cast<size_t>(comm.size()) &&
+         "layout doesn't match the communicator");
+  assert(data.size() >= layout.getSendSize() &&
+         result.size() >= layout.getRecvSize() &&
+         "buffers are too small for the layout");
+  auto type = TypeSelector::getHandle();
+  detail::exitOnError(MPI_Alltoallv(
+      data.data(), layout.send_counts.data(), layout.send_displs.data(), type,
+      result.data(), layout.recv_counts.data(), layout.recv_displs.data(),
+      type, comm));
+}
+
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+std::vector<ScalarT> alltoallv(ArrayRef<ScalarT> data,
+                               const AlltoallvLayout &layout,
+                               const Comm &comm = MPI_COMM_WORLD) {
+  std::vector<ScalarT> result(layout.getRecvSize());
+  alltoallv<ScalarT, TypeSelector>(data, layout,
+                                   MutableArrayRef<ScalarT>(result), comm);
+  return result;
+}
+
+/* Sends buckets[i] to process i. Returns buckets received from each
+ * process. Takes two rounds: sizes first, then all buckets at once */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+std::vector<std::vector<ScalarT>>
+exchangeBuckets(const std::vector<std::vector<ScalarT, Allocator>> &buckets,
+                const Comm &comm = MPI_COMM_WORLD) {
+  assert(buckets.size() == static_cast<size_t>(comm.size()) &&
+         "there must be a bucket for each process");
+  std::vector<int> send_counts;
+  std::vector<ScalarT> send_buf;
+  for (const auto &bucket : buckets) {
+    send_counts.push_back(detail::getAlltoallCount(bucket.size()));
+    send_buf.insert(send_buf.end(), bucket.begin(), bucket.end());
+  }
+  auto layout = AlltoallvLayout::fromSendCounts(std::move(send_counts), comm);
+  auto recv_buf =
+      alltoallv<ScalarT, TypeSelector>(ArrayRef<ScalarT>(send_buf), layout,
+                                       comm);
+
+  std::vector<std::vector<ScalarT>> result(buckets.size());
+  for (size_t i = 0; i < result.size(); ++i) {
+    auto first = recv_buf.begin() + layout.recv_displs[i];
+    result[i].assign(first, first + layout.recv_counts[i]);
+  }
+  return result;
+}
+
+} // namespace cxxmpi
@@ -1,37 +1,229 @@
 #pragma once
 
+#include "../P2P/BlockingMessages.hpp"
+#include "../P2P/NonblockingMessages.hpp"
 #include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/DefaultInitAllocator.hpp"
 #include "../Util/WorkSplitter.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <numeric>
 
 namespace cxxmpi {
 
-void barrier(MPI_Comm comm = MPI_COMM_WORLD) {
+inline void barrier(const Comm &comm = MPI_COMM_WORLD) {
   detail::exitOnError(MPI_Barrier(comm));
 }
 
 /* bcast scalar */
 template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
-void bcast(ScalarT &data, int root, MPI_Comm comm = MPI_COMM_WORLD) {
+void bcast(ScalarT &data, int root, const Comm &comm = MPI_COMM_WORLD) {
   detail::exitOnError(
       MPI_Bcast(&data, 1, TypeSelector::getHandle(), root, comm));
 }
 
+namespace detail {
+
+/* Dynamically sized containers are broadcast with the size and the
+ * beginning of data packed into a single buffer of this size. So short
+ * containers take one round, longer ones take one more round for the rest */
+constexpr int BcastEagerBytes = 2048;
+
+/* Number of elements of type, which fit into eager buffer after the size */
+inline size_t getBcastEagerCount(MPI_Datatype type, const Comm &comm) {
+  int header_sz, elem_sz;
+  exitOnError(MPI_Pack_size(1, MPI_UNSIGNED_LONG_LONG, comm, &header_sz));
+  exitOnError(MPI_Pack_size(1, type, comm, &elem_sz));
+  if (elem_sz == 0 || header_sz + elem_sz > BcastEagerBytes)
+    return 0;
+  return (BcastEagerBytes - header_sz) / elem_sz;
+}
+
+template <class TypeSelector, class Container>
+void bcastContainer(Container &data, int root, const Comm &comm) {
+  MPI_Datatype type = TypeSelector::getHandle();
+  bool is_root = (commRank(comm) == root);
+  size_t eager_count = getBcastEagerCount(type, comm);
+  Buffer<char> buf(BcastEagerBytes);
+  int pos = 0;
+
+  unsigned long long sz = data.size();
+  if (is_root) {
+    exitOnError(MPI_Pack(&sz, 1, MPI_UNSIGNED_LONG_LONG, buf.data(),
+                         BcastEagerBytes, &pos, comm));
+    if (int n = std::min<size_t>(sz, eager_count))
+      exitOnError(MPI_Pack(data.data(), n, type, buf.data(), BcastEagerBytes,
+                           &pos, comm));
+  }
+  exitOnError(MPI_Bcast(buf.data(), BcastEagerBytes, MPI_PACKED, root, comm));
+  if (!is_root) {
+    exitOnError(MPI_Unpack(buf.data(), BcastEagerBytes, &pos, &sz, 1,
+                           MPI_UNSIGNED_LONG_LONG, comm));
+    data.resize(sz);
+    if (int n = std::min<size_t>(sz, eager_count))
+      exitOnError(MPI_Unpack(buf.data(), BcastEagerBytes, &pos,
+                             getWritableData(data), n, type, comm));
+  }
+
+  if (sz <= eager_count)
+    return;
+  LargeCount lc{sz - eager_count, type};
+  exitOnError(MPI_Bcast(getWritableData(data) + eager_count, lc.count(),
+                        lc.type(), root, comm));
+}
+
+template <class TypeSelector, class Container>
+void bcastBoundedContainer(Container &data, size_t max_size, int root,
+                           const Comm &comm) {
+  MPI_Datatype type = TypeSelector::getHandle();
+  bool is_root = (commRank(comm) == root);
+  assert(fitsInt(max_size) && "max_size doesn't fit into int");
+  assert((!is_root || data.size() <= max_size) &&
+         "data is longer than max_size");
+
+  int header_sz, data_sz;
+  exitOnError(MPI_Pack_size(1, MPI_UNSIGNED_LONG_LONG, comm, &header_sz));
+  exitOnError(MPI_Pack_size(max_size, type, comm, &data_sz));
+  int buf_sz = header_sz + data_sz;
+  Buffer<char> buf(buf_sz);
+  int pos = 0;
+
+  unsigned long long sz = data.size();
+  if (is_root) {
+    exitOnError(MPI_Pack(&sz, 1, MPI_UNSIGNED_LONG_LONG, buf.data(), buf_sz,
+                         &pos, comm));
+    exitOnError(MPI_Pack(data.data(), sz, type, buf.data(), buf_sz, &pos,
+                         comm));
+  }
+  exitOnError(MPI_Bcast(buf.data(), buf_sz, MPI_PACKED, root, comm));
+  if (is_root)
+    return;
+  exitOnError(MPI_Unpack(buf.data(), buf_sz, &pos, &sz, 1,
+                         MPI_UNSIGNED_LONG_LONG, comm));
+  data.resize(sz);
+  exitOnError(MPI_Unpack(buf.data(), buf_sz, &pos, getWritableData(data), sz,
+                         type, comm));
+}
+
+/* Used on internal duplicate of the communicator (see getInternalComm()) */
+constexpr int PipelinedBcastTag = 32765;
+constexpr int PipelinedBcastSegmentBytes = 1 << 16;
+
+} // namespace detail
+
 /* bcast string
- * non-atomic impl (!) */
+ * Size goes together with the beginning of the string, so short strings
+ * take a single MPI_Bcast() */
 template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
           class CharTraits, class Allocator>
 void bcast(std::basic_string<CharT, CharTraits, Allocator> &data, int root,
-           MPI_Comm comm = MPI_COMM_WORLD) {
-  /* broadcast size */
+           const Comm &comm = MPI_COMM_WORLD) {
+  detail::bcastContainer<TypeSelector>(data, root, comm);
+}
+
+/* bcast vector, it's resized on non-root processes
+ * As for strings, short vectors take a single MPI_Bcast() */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+void bcast(std::vector<ScalarT, Allocator> &data, int root,
+           const Comm &comm = MPI_COMM_WORLD) {
+  detail::bcastContainer<TypeSelector>(data, root, comm);
+}
+
+/* Single-round bcast of vector which has at most max_size elements
+ * max_size must be the same on all processes. max_size elements are always
+ * transferred, so it's worth only if the bound is tight */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+void bcastBounded(std::vector<ScalarT, Allocator> &data, size_t max_size,
+                  int root, const Comm &comm = MPI_COMM_WORLD) {
+  detail::bcastBoundedContainer<TypeSelector>(data, max_size, root, comm);
+}
+
+template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
+          class CharTraits, class Allocator>
+void bcastBounded(std::basic_string<CharT, CharTraits, Allocator> &data,
+                  size_t max_size, int root,
+                  const Comm &comm = MPI_COMM_WORLD) {
+  detail::bcastBoundedContainer<TypeSelector>(data, max_size, root, comm);
+}
+
+/* bcast any contiguous range
+ * Range must have the same size on all processes */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+void bcast(MutableArrayRef<ScalarT> data, int root,
+           const Comm &comm = MPI_COMM_WORLD) {
+  detail::LargeCount lc{data.size(), TypeSelector::getHandle()};
+  detail::exitOnError(
+      MPI_Bcast(data.data(), lc.count(), lc.type(), root, comm));
+}
+
+/* Pipelined bcast of large contiguous range
+ * Data is split into segments, which are streamed along the chain
+ * root -> root + 1 -> ..., so each process forwards a segment while
+ * receiving the next one. It takes about (commSize() + segments - 1)
+ * segment transfers, i.e. unlike MPI_Bcast() the bandwidth term doesn't
+ * grow with the number of processes. Worth for messages much larger than
+ * segment_size (in elements, 0 means 64 KiB worth of elements)
+ * Range must have the same size on all processes */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+void bcastPipelined(MutableArrayRef<ScalarT> data, int root,
+                    const Comm &comm = MPI_COMM_WORLD,
+                    size_t segment_size = 0) {
+  MPI_Datatype type = TypeSelector::getHandle();
+  Comm internal = detail::getInternalComm(comm);
+  int comm_sz = commSize(comm);
+  int rel_rank = (commRank(comm) - root + comm_sz) % comm_sz;
+  int prev = (root + rel_rank - 1) % comm_sz;
+  int next = (root + rel_rank + 1) % comm_sz;
+  bool has_prev = rel_rank > 0;
+  bool has_next = rel_rank + 1 < comm_sz;
+
+  if (segment_size == 0) {
+    int type_sz;
+    detail::exitOnError(MPI_Type_size(type, &type_sz));
+    segment_size = std::max(1, detail::PipelinedBcastSegmentBytes /
+                                   std::max(type_sz, 1));
+  }
+  size_t num_segments = (data.size() + segment_size - 1) / segment_size;
+  auto segment = [&](size_t i) {
+    size_t begin = i * segment_size;
+    return data.slice(begin, std::min(segment_size, data.size() - begin));
+  };
+
+  /* all receives are posted in advance, messages from one source with the
+   * same tag are matched in order */
+  std::vector<Request> recvs;
+  if (has_prev)
+    for (size_t i = 0; i < num_segments; ++i)
+      recvs.push_back(detail::irecvRaw(segment(i).data(), segment(i).size(),
+                                       type, prev, detail::PipelinedBcastTag,
+                                       internal));
+  std::vector<Request> sends;
+  for (size_t i = 0; i < num_segments; ++i) {
+    if (has_prev)
+      recvs[i].wait();
+    if (has_next)
+      sends.push_back(detail::isendRaw(segment(i).data(), segment(i).size(),
+                                       type, next, detail::PipelinedBcastTag,
+                                       internal));
+  }
+  waitAll(sends);
+}
+
+/* Pipelined bcast of vector, it's resized on non-root processes */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+void bcastPipelined(std::vector<ScalarT, Allocator> &data, int root,
+                    const Comm &comm = MPI_COMM_WORLD,
+                    size_t segment_size = 0) {
   size_t sz = data.size();
   bcast(sz, root, comm);
   data.resize(sz);
-  /* broadcast data */
-  detail::exitOnError(
-      MPI_Bcast(&data[0], sz, TypeSelector::getHandle(), root, comm));
+  bcastPipelined<ScalarT, TypeSelector>(MutableArrayRef<ScalarT>(data), root,
+                                        comm, segment_size);
 }
 
 /* CommunicationResult is used in different collective communication
@@ -90,13 +282,14 @@ private:
   }
 };
 
-template <class T> using GatherResult = CommunicationResult<std::vector<T>>;
+template <class T, class Allocator = std::allocator<T>>
+using GatherResult = CommunicationResult<std::vector<T, Allocator>>;
 
 /* Gather scalar
  * See description of CommunicationResult above */
 template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
 GatherResult<ScalarT> gather(const ScalarT &value_to_send, int root = 0,
-                             MPI_Comm comm = MPI_COMM_WORLD) {
+                             const Comm &comm = MPI_COMM_WORLD) {
   std::vector<ScalarT> result;
   auto type = TypeSelector::getHandle();
   bool is_root = (commRank(comm) == root);
@@ -111,27 +304,108 @@ GatherResult<ScalarT> gather(const ScalarT &value_to_send, int root = 0,
                  : GatherResult<ScalarT>{};
 }
 
-/* Gather multiple strings into one
- * Non-atomic impl ! */
-template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
-          class CharTraits, class Allocator>
-CommunicationResult<std::basic_string<CharT, CharTraits, Allocator>>
-gatherv(const std::basic_string<CharT, CharTraits, Allocator> &value_to_send,
-        int root = 0, MPI_Comm comm = MPI_COMM_WORLD) {
+namespace detail {
+
+/* Collectives fall back to point-to-point messages with this tag when
+ * counts don't fit into int and MPI-4 "_c" functions are not available.
+ * Messages go through internal duplicate of the communicator (see
+ * getInternalComm()), so they never meet user's messages. MPI guarantees
+ * that MPI_TAG_UB is at least 32767 */
+constexpr int LargeCollectiveTag = 32767;
+
+/* counts and displs only matter on root */
+template <class ScalarT>
+void gathervLargeP2P(ArrayRef<ScalarT> value_to_send, ScalarT *result,
+                     const std::vector<long long> &counts,
+                     const std::vector<long long> &displs, MPI_Datatype type,
+                     int root, const Comm &comm) {
+  Comm internal = getInternalComm(comm);
+  int rank = commRank(comm);
+  if (rank != root) {
+    if (!value_to_send.empty())
+      sendRaw(value_to_send.data(), value_to_send.size(), type, root,
+              LargeCollectiveTag, internal);
+    return;
+  }
+  std::vector<Request> requests;
+  for (int i = 0, comm_sz = counts.size(); i < comm_sz; ++i)
+    if (i != root && counts[i])
+      requests.push_back(irecvRaw(result + displs[i], counts[i], type, i,
+                                  LargeCollectiveTag, internal));
+  /* nothing to copy if root's part is already in place */
+  if (value_to_send.data() != result + displs[root])
+    std::copy(value_to_send.begin(), value_to_send.end(),
+              result + displs[root]);
+  waitAll(requests);
+}
 
-  using ResultT =
-      CommunicationResult<std::basic_string<CharT, CharTraits, Allocator>>;
+template <class ScalarT>
+void scattervLargeP2P(ArrayRef<ScalarT> data, MutableArrayRef<ScalarT> result,
+                      const std::vector<long long> &counts,
+                      const std::vector<long long> &displs, MPI_Datatype type,
+                      int root, const Comm &comm) {
+  Comm internal = getInternalComm(comm);
+  int rank = commRank(comm);
+  if (rank != root) {
+    if (counts[rank])
+      recvRaw(result.data(), counts[rank], type, root, LargeCollectiveTag,
+              internal);
+    return;
+  }
+  std::vector<Request> requests;
+  for (int i = 0, comm_sz = counts.size(); i < comm_sz; ++i)
+    if (i != root && counts[i])
+      requests.push_back(isendRaw(data.data() + displs[i], counts[i], type, i,
+                                  LargeCollectiveTag, internal));
+  if (data.data() + displs[root] != result.data())
+    std::copy(data.begin() + displs[root],
+              data.begin() + displs[root] + counts[root], result.begin());
+  waitAll(requests);
+}
+
+/* Adapts MutableArrayRef to gathervIntoContainer(): resize() only checks
+ * that there is enough room */
+template <class ScalarT> class FixedSizeOutput {
+public:
+  explicit FixedSizeOutput(MutableArrayRef<ScalarT> out) : out(out) {}
+
+  void resize(size_t sz) {
+    assert(sz <= out.size() && "not enough room for the received data");
+    used = sz;
+  }
+  ScalarT *data() const { return out.data(); }
+  size_t size() const { return used; }
 
+private:
+  MutableArrayRef<ScalarT> out;
+  size_t used = 0;
+};
+
+template <class ScalarT>
+ScalarT *getWritableData(FixedSizeOutput<ScalarT> &out) {
+  return out.data();
+}
+
+/* Gathers contributions of variable size into result on root
+ * result is resized on root to fit all the data, it's untouched on other
+ * processes. Returns true on root. Without MPI-4 the total must fit into
+ * int, unless allow_large is set on all processes (see gathervLarge()) */
+template <class TypeSelector, class ScalarT, class ResultContainer>
+bool gathervIntoContainer(ArrayRef<ScalarT> value_to_send,
+                          ResultContainer &result, int root, const Comm &comm,
+                          bool allow_large = false) {
   MPI_Datatype type = TypeSelector::getHandle();
-  int value_size = value_to_send.size();
   bool is_root = (commRank(comm) == root);
 
+#if CXXMPI_HAS_LARGE_COUNT
+  (void)allow_large;
+  MPI_Count value_size = value_to_send.size();
+
   /* These only make sence for root */
-  std::basic_string<CharT, CharTraits, Allocator> result;
-  std::vector<int> recv_counts;
-  std::vector<int> displs;
+  std::vector<MPI_Count> recv_counts;
+  std::vector<MPI_Aint> displs;
 
-  /* Gather string sizes */
+  /* Gather sizes */
   if (auto gather_res = gather(value_size, root, comm)) {
     recv_counts = gather_res.takeData();
     displs.push_back(0);
@@ -140,72 +414,310 @@ gatherv(const std::basic_string<CharT, CharTraits, Allocator> &value_to_send,
     result.resize(displs.back());
   }
 
-  detail::exitOnError(MPI_Gatherv(value_to_send.data(), value_to_send.size(),
-                                  type, &result[0], recv_counts.data(),
-                                  displs.data(), type, root, comm));
-  return is_root ? ResultT{std::move(result)} : ResultT{};
+  exitOnError(MPI_Gatherv_c(value_to_send.data(), value_size, type,
+                            getWritableData(result), recv_counts.data(),
+                            displs.data(), type, root, comm));
+#else
+  long long value_size = value_to_send.size();
+  std::vector<long long> counts(is_root ? commSize(comm) : 0);
+  exitOnError(MPI_Gather(&value_size, 1, MPI_LONG_LONG, counts.data(), 1,
+                         MPI_LONG_LONG, root, comm));
+  std::vector<long long> displs{0};
+  std::partial_sum(counts.begin(), counts.end(), std::back_inserter(displs));
+  if (is_root)
+    result.resize(displs.back());
+
+  /* Only root knows the total, so choosing the algorithm takes one more
+   * round, which is paid only when large totals are allowed */
+  if (allow_large) {
+    int fits_int = fitsInt(displs.back());
+    exitOnError(MPI_Bcast(&fits_int, 1, MPI_INT, root, comm));
+    if (!fits_int) {
+      gathervLargeP2P(value_to_send, getWritableData(result), counts, displs,
+                      type, root, comm);
+      return is_root;
+    }
+  }
+  assert(fitsInt(value_size) && fitsInt(displs.back()) &&
+         "use gathervLarge() for more than INT_MAX elements in total");
+
+  std::vector<int> recv_counts(counts.begin(), counts.end());
+  std::vector<int> recv_displs(displs.begin(), displs.end());
+  exitOnError(MPI_Gatherv(value_to_send.data(), value_size, type,
+                          getWritableData(result), recv_counts.data(),
+                          recv_displs.data(), type, root, comm));
+#endif
+  return is_root;
+}
+
+} // namespace detail
+
+/* Gather strings into one, concatenated in rank order */
+template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
+          class CharTraits, class Allocator>
+CommunicationResult<std::basic_string<CharT, CharTraits, Allocator>>
+gatherv(const std::basic_string<CharT, CharTraits, Allocator> &value_to_send,
+        int root = 0, const Comm &comm = MPI_COMM_WORLD) {
+  using ResultT =
+      CommunicationResult<std::basic_string<CharT, CharTraits, Allocator>>;
+  std::basic_string<CharT, CharTraits, Allocator> result;
+  if (detail::gathervIntoContainer<TypeSelector>(
+          ArrayRef<CharT>(value_to_send.data(), value_to_send.size()), result,
+          root, comm))
+    return ResultT{std::move(result)};
+  return ResultT{};
+}
+
+/* Result has the same allocator as value_to_send, so gathering a
+ * cxxmpi::Buffer doesn't zero-fill the result on root */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+GatherResult<ScalarT, Allocator>
+gatherv(const std::vector<ScalarT, Allocator> &value_to_send,
+        int root = 0, const Comm &comm = MPI_COMM_WORLD) {
+  std::vector<ScalarT, Allocator> result;
+  if (detail::gathervIntoContainer<TypeSelector>(
+          ArrayRef<ScalarT>(value_to_send), result, root, comm))
+    return GatherResult<ScalarT, Allocator>{std::move(result)};
+  return GatherResult<ScalarT, Allocator>{};
 }
 
-/* to do: merge it with string gatherv */
+/* Gather any contiguous ranges, e.g. parts of bigger buffers */
 template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
-GatherResult<ScalarT>
-gatherv(const std::vector<ScalarT> &value_to_send,
-        int root = 0, MPI_Comm comm = MPI_COMM_WORLD) {
+GatherResult<ScalarT> gatherv(ArrayRef<ScalarT> value_to_send, int root = 0,
+                              const Comm &comm = MPI_COMM_WORLD) {
+  std::vector<ScalarT> result;
+  if (detail::gathervIntoContainer<TypeSelector>(value_to_send, result, root,
+                                                 comm))
+    return GatherResult<ScalarT>{std::move(result)};
+  return GatherResult<ScalarT>{};
+}
 
-  using ResultT = GatherResult<ScalarT>;
+/* Gather into caller-provided storage, which must have room for all the data
+ * on root (and is ignored on other processes)
+ * Returns the number of gathered elements on root and 0 on others */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+size_t gatherv(ArrayRef<ScalarT> value_to_send, MutableArrayRef<ScalarT> result,
+               int root = 0, const Comm &comm = MPI_COMM_WORLD) {
+  detail::FixedSizeOutput<ScalarT> out{result};
+  detail::gathervIntoContainer<TypeSelector>(value_to_send, out, root, comm);
+  return out.size();
+}
 
-  MPI_Datatype type = TypeSelector::getHandle();
-  int value_size = value_to_send.size();
-  bool is_root = (commRank(comm) == root);
+/* gatherv() which also works for more than INT_MAX elements in total when
+ * MPI-4 "_c" functions are not available. Deciding on that costs one more
+ * bcast per call, so use it only where such totals are possible */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+GatherResult<ScalarT, Allocator>
+gathervLarge(const std::vector<ScalarT, Allocator> &value_to_send,
+             int root = 0, const Comm &comm = MPI_COMM_WORLD) {
+  std::vector<ScalarT, Allocator> result;
+  if (detail::gathervIntoContainer<TypeSelector>(
+          ArrayRef<ScalarT>(value_to_send), result, root, comm, true))
+    return GatherResult<ScalarT, Allocator>{std::move(result)};
+  return GatherResult<ScalarT, Allocator>{};
+}
 
-  /* These only make sence for root */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+GatherResult<ScalarT> gathervLarge(ArrayRef<ScalarT> value_to_send,
+                                   int root = 0,
+                                   const Comm &comm = MPI_COMM_WORLD) {
   std::vector<ScalarT> result;
-  std::vector<int> recv_counts;
-  std::vector<int> displs;
+  if (detail::gathervIntoContainer<TypeSelector>(value_to_send, result, root,
+                                                 comm, true))
+    return GatherResult<ScalarT>{std::move(result)};
+  return GatherResult<ScalarT>{};
+}
 
-  /* Gather string sizes */
-  if (auto gather_res = gather(value_size, root, comm)) {
-    recv_counts = gather_res.takeData();
-    displs.push_back(0);
-    std::partial_sum(recv_counts.begin(), recv_counts.end(),
-                     std::back_inserter(displs));
-    result.resize(displs.back());
+namespace detail {
+
+/* Scatters data_sz elements split by WorkSplitterLinear64. If in_place is
+ * set, root's result must point to its own part of data, which is then
+ * left where it is (MPI_IN_PLACE) */
+template <class TypeSelector, class ScalarT>
+size_t scatterFairRaw(const ScalarT *data, size_t data_sz, ScalarT *result,
+                      bool in_place, int root, const Comm &comm) {
+  auto rank = commRank(comm);
+  auto comm_sz = commSize(comm);
+  auto splitter = util::WorkSplitterLinear64{static_cast<long long>(data_sz),
+                                             comm_sz};
+  auto type = TypeSelector::getHandle();
+  size_t recv_sz = splitter.getRange(rank).size();
+  void *recv_buf = (rank == root && in_place) ? MPI_IN_PLACE : result;
+
+  /* all processes know data_sz, so the choice is consistent */
+  if (!fitsInt(data_sz)) {
+#if CXXMPI_HAS_LARGE_COUNT
+    auto sizes = splitter.getSizes<MPI_Count>();
+    auto displs = splitter.getDisplacements<MPI_Aint>();
+    exitOnError(MPI_Scatterv_c(data, sizes.data(), displs.data(), type,
+                               recv_buf, recv_sz, type, root, comm));
+#else
+    scattervLargeP2P(ArrayRef<ScalarT>(data, rank == root ? data_sz : 0),
+                     MutableArrayRef<ScalarT>(result, recv_sz),
+                     splitter.getSizes(), splitter.getDisplacements(), type,
+                     root, comm);
+#endif
+    return recv_sz;
   }
 
-  detail::exitOnError(MPI_Gatherv(value_to_send.data(), value_to_send.size(),
-                                  type, &result[0], recv_counts.data(),
-                                  displs.data(), type, root, comm));
-  return is_root ? ResultT{std::move(result)} : ResultT{};
+  /* plain scatter doesn't need counts and displacements at all */
+  if (splitter.isEvenlyDivided()) {
+    exitOnError(MPI_Scatter(data, recv_sz, type, recv_buf, recv_sz, type,
+                            root, comm));
+    return recv_sz;
+  }
+
+  auto sizes = splitter.getSizes<int>();
+  auto displs = splitter.getDisplacements<int>();
+  exitOnError(MPI_Scatterv(data, sizes.data(), displs.data(), type, recv_buf,
+                           recv_sz, type, root, comm));
+  return recv_sz;
 }
 
+} // namespace detail
+
 /* Scatters the data as much fairly as possible, i.e. all processes will
  * get approximatelly the same amount of data
  * data argument is taken into account only for process with rank == root.
- * For all other processes it must be empty due to debug simplification */
+ * result must have room for this process' part of data, i.e. at least
+ * util::WorkSplitterLinear64(data_sz, commSize(comm)).getMaxWorkSize().
+ * Returns the number of received elements */
 template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
-std::vector<ScalarT> scatterFair(std::vector<ScalarT> &data, size_t data_sz,
-                                 int root, MPI_Comm comm = MPI_COMM_WORLD) {
-  // TODO: optimize a case when data can be scattered evenly,
-  // i.e. plain MPI_Scatter can be used (data.size() % comm_sz == 0)
+size_t scatterFair(ArrayRef<ScalarT> data, size_t data_sz,
+                   MutableArrayRef<ScalarT> result, int root,
+                   const Comm &comm = MPI_COMM_WORLD) {
   auto rank = commRank(comm);
-  auto comm_sz = commSize(comm);
   if (rank == root) {
     assert(data.size() == data_sz &&
-           "passed data_sz value must match the size of the passed vector");
+           "passed data_sz value must match the size of the passed data");
+  }
+  size_t recv_sz = util::WorkSplitterLinear64{static_cast<long long>(data_sz),
+                                              commSize(comm)}
+                       .getRange(rank)
+                       .size();
+  assert(result.size() >= recv_sz && "not enough room for the received data");
+  (void)recv_sz;
+  return detail::scatterFairRaw<TypeSelector>(data.data(), data_sz,
+                                              result.data(), false, root, comm);
+}
+
+/* The same as above, but result is allocated by scatterFair()
+ * For non-root processes data must be empty due to debug simplification
+ * Result has the same allocator as data, i.e. it is not zero-filled
+ * if data is cxxmpi::Buffer */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+std::vector<ScalarT, Allocator>
+scatterFair(std::vector<ScalarT, Allocator> &data, size_t data_sz, int root,
+            const Comm &comm = MPI_COMM_WORLD) {
+  auto rank = commRank(comm);
+  assert((rank == root || data.size() == 0) &&
+         "data must be empty for non-root procesees");
+  auto splitter = util::WorkSplitterLinear64{
+      static_cast<long long>(data_sz), commSize(comm)};
+  std::vector<ScalarT, Allocator> result(splitter.getRange(rank).size());
+  scatterFair<ScalarT, TypeSelector>(ArrayRef<ScalarT>(data), data_sz,
+                                     MutableArrayRef<ScalarT>(result), root,
+                                     comm);
+  return result;
+}
+
+/* Scatter from any contiguous range */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+std::vector<ScalarT> scatterFair(ArrayRef<ScalarT> data, size_t data_sz,
+                                 int root, const Comm &comm = MPI_COMM_WORLD) {
+  auto splitter = util::WorkSplitterLinear64{
+      static_cast<long long>(data_sz), commSize(comm)};
+  std::vector<ScalarT> result(splitter.getRange(commRank(comm)).size());
+  scatterFair<ScalarT, TypeSelector>(data, data_sz,
+                                     MutableArrayRef<ScalarT>(result), root,
+                                     comm);
+  return result;
+}
+
+/* The same as scatterFair(), but root doesn't copy its own part: on root
+ * data keeps the whole array and the returned view points to root's part
+ * of it. On other processes data is resized to fit the received part and
+ * the view covers all of it
+ *
+ * Example:
+ * auto Chunk = mpi::scatterFairInPlace(Data, DataSz, 0);
+ * std::transform(Chunk.begin(), Chunk.end(), Chunk.begin(), f);
+ * if (mpi::gatherFairInPlace(Data, DataSz, 0))
+ *   ... // Data contains the whole transformed array
+ */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+MutableArrayRef<ScalarT>
+scatterFairInPlace(std::vector<ScalarT, Allocator> &data, size_t data_sz,
+                   int root, const Comm &comm = MPI_COMM_WORLD) {
+  auto rank = commRank(comm);
+  auto range = util::WorkSplitterLinear64{static_cast<long long>(data_sz),
+                                          commSize(comm)}
+                   .getRange(rank);
+  ScalarT *result;
+  if (rank == root) {
+    assert(data.size() == data_sz &&
+           "passed data_sz value must match the size of the passed data");
+    result = data.data() + range.FirstIdx;
   } else {
-    assert(data.size() == 0 && "data must be empty for non-root procesees");
+    data.resize(range.size());
+    result = data.data();
   }
+  detail::scatterFairRaw<TypeSelector>(data.data(), data_sz, result, true,
+                                       root, comm);
+  return MutableArrayRef<ScalarT>(result, range.size());
+}
 
-  auto splitter = util::WorkSplitterLinear{static_cast<int>(data_sz), comm_sz};
-  auto sizes = splitter.getSizes();
-  auto displs = splitter.getDisplacements();
+/* Inverse of scatterFairInPlace(): gathers parts split the same way as in
+ * scatterFair() into data on root. Root's own part must already be at its
+ * place in data (which has data_sz elements), on other processes data is
+ * exactly their part. Returns true on root */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+bool gatherFairInPlace(std::vector<ScalarT, Allocator> &data, size_t data_sz,
+                       int root, const Comm &comm = MPI_COMM_WORLD) {
+  auto rank = commRank(comm);
+  bool is_root = (rank == root);
+  auto splitter = util::WorkSplitterLinear64{static_cast<long long>(data_sz),
+                                             commSize(comm)};
+  auto range = splitter.getRange(rank);
+  size_t local_sz = range.size();
+  assert(data.size() == (is_root ? data_sz : local_sz) &&
+         "data doesn't match the layout");
   auto type = TypeSelector::getHandle();
-  std::vector<ScalarT> result(sizes[rank]);
+  const void *send_buf = is_root ? MPI_IN_PLACE : data.data();
+
+  if (!detail::fitsInt(data_sz)) {
+#if CXXMPI_HAS_LARGE_COUNT
+    auto sizes = splitter.getSizes<MPI_Count>();
+    auto displs = splitter.getDisplacements<MPI_Aint>();
+    detail::exitOnError(MPI_Gatherv_c(send_buf, local_sz, type, data.data(),
+                                      sizes.data(), displs.data(), type, root,
+                                      comm));
+#else
+    ScalarT *local = is_root ? data.data() + range.FirstIdx : data.data();
+    detail::gathervLargeP2P(ArrayRef<ScalarT>(local, local_sz), data.data(),
+                            splitter.getSizes(), splitter.getDisplacements(),
+                            type, root, comm);
+#endif
+    return is_root;
+  }
 
-  detail::exitOnError(MPI_Scatterv(data.data(), sizes.data(), displs.data(),
-                                   type, result.data(), sizes[rank], type, root,
-                                   comm));
-  return result;
+  if (splitter.isEvenlyDivided()) {
+    detail::exitOnError(MPI_Gather(send_buf, local_sz, type, data.data(),
+                                   local_sz, type, root, comm));
+    return is_root;
+  }
+
+  auto sizes = splitter.getSizes<int>();
+  auto displs = splitter.getDisplacements<int>();
+  detail::exitOnError(MPI_Gatherv(send_buf, local_sz, type, data.data(),
+                                  sizes.data(), displs.data(), type, root,
+                                  comm));
+  return is_root;
 }
 
 } // namespace cxxmpi
\ No newline at end of file
@@ -0,0 +1,321 @@
+/* Plans are precomputed layouts of gatherv and scatterv operations
+ *
+ * gatherv() and scatterFair() compute counts and displacements on each
+ * call, and gatherv() also has to gather sizes first. When the layout
+ * doesn't change between calls (e.g. the same distributed array is
+ * gathered every iteration), build a plan once and each gather() or
+ * scatter() is a single MPI_Gatherv()/MPI_Scatterv() with no allocations.
+ *
+ * Example:
+ * auto Plan = cxxmpi::GathervPlan::fromLocalSize(Local.size(), 0);
+ * std::vector<double> Global; // grows once on root, then reused
+ * while (...) {
+ *   step(Local);
+ *   if (Plan.gather(Local, Global))
+ *     dump(Global);
+ * }
+ *
+ * Counts are int, so plans are limited to INT_MAX elements in total. Plan
+ * keeps the handle of its communicator, so the communicator (e.g. Comm made
+ * by dup() or split()) must outlive the plan
+ */
+
+#pragma once
+
+#include "../P2P/NonblockingMessages.hpp"
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+#include "../Util/WorkSplitter.hpp"
+
+#include <cassert>
+#include <numeric>
+#include <vector>
+
+namespace cxxmpi {
+namespace detail {
+
+/* Counts and displacements shared by both plans. Counts are always known
+ * on root, local_count may be unknown (-1) on other processes */
+class VarCountLayout {
+public:
+  int getRoot() const { return root; }
+  MPI_Comm getComm() const { return comm; }
+  bool isRoot() const { return is_root; }
+
+  /* Only meaningful on root */
+  ArrayRef<int> getCounts() const { return counts; }
+  ArrayRef<int> getDisplacements() const { return displs; }
+  size_t getTotalSize() const { return total; }
+
+protected:
+  int root = 0;
+  /* not owned, must outlive the plan */
+  MPI_Comm comm = MPI_COMM_WORLD;
+  bool is_root = false;
+  /* false for default-constructed (empty) plan */
+  bool initialized = false;
+  int local_count = -1;
+  size_t total = 0;
+  std::vector<int> counts;
+  std::vector<int> displs;
+
+  VarCountLayout() = default;
+  VarCountLayout(int root, const Comm &comm)
+      : root(root), comm(comm), is_root(commRank(comm) == root),
+        initialized(true) {}
+
+  void assertInitialized() const {
+    assert(initialized && "Trying to use empty plan");
+  }
+
+  /* Everyone knows the layout, nothing is communicated */
+  void initFromSplitter(const util::WorkSplitterLinear &splitter,
+                        int item_size) {
+    assert(splitter.getNumWorkers() == commSize(comm) &&
+           "splitter must split work between all processes");
+    assert(item_size > 0 && "invalid item size");
+    counts = splitter.getSizes();
+    displs = splitter.getDisplacements();
+    for (size_t i = 0; i < counts.size(); ++i) {
+      assert(fitsInt(static_cast<size_t>(counts[i]) * item_size) &&
+             fitsInt(static_cast<size_t>(displs[i]) * item_size) &&
+             "layout doesn't fit into int");
+      counts[i] *= item_size;
+      displs[i] *= item_size;
+    }
+    local_count = counts[commRank(comm)];
+    total = static_cast<size_t>(splitter.getWorkSize()) * item_size;
+  }
+
+  /* counts are significant only on root */
+  void initDisplacements() {
+    if (!is_root)
+      return;
+    assert(counts.size() == static_cast<size_t>(commSize(comm)) &&
+           "counts must be specified for each process");
+    displs.assign(1, 0);
+    std::partial_sum(counts.begin(), counts.end() - 1,
+                     std::back_inserter(displs));
+    total = std::accumulate(counts.begin(), counts.end(), size_t{0});
+    assert(fitsInt(total) && "layout doesn't fit into int");
+  }
+
+  /* Collective: root learns count of each process */
+  void gatherCounts(size_t local_size) {
+    assert(fitsInt(local_size) && "layout doesn't fit into int");
+    local_count = static_cast<int>(local_size);
+    if (is_root)
+      counts.resize(commSize(comm));
+    exitOnError(MPI_Gather(&local_count, 1, MPI_INT, counts.data(), 1,
+                           MPI_INT, root, comm));
+    initDisplacements();
+  }
+};
+
+} // namespace detail
+
+/* Precomputed layout for gathering parts of variable size to root */
+class GathervPlan : public detail::VarCountLayout {
+public:
+  /* Empty plan, has to be assigned before use */
+  GathervPlan() = default;
+
+  /* Parts are split by splitter, each work item consists of item_size
+   * elements (e.g. rows of a matrix). Doesn't communicate */
+  explicit GathervPlan(const util::WorkSplitterLinear &splitter, int root = 0,
+                       const Comm &comm = MPI_COMM_WORLD, int item_size = 1)
+      : VarCountLayout(root, comm) {
+    initFromSplitter(splitter, item_size);
+  }
+
+  /* Collective: each process contributes local_size elements */
+  static GathervPlan fromLocalSize(size_t local_size, int root = 0,
+                                   const Comm &comm = MPI_COMM_WORLD) {
+    GathervPlan res{root, comm};
+    res.gatherCounts(local_size);
+    return res;
+  }
+
+  /* i-th process contributes counts[i] elements. counts are significant
+   * only on root. Doesn't communicate */
+  static GathervPlan fromCounts(std::vector<int> counts, int root = 0,
+                                const Comm &comm = MPI_COMM_WORLD) {
+    GathervPlan res{root, comm};
+    res.counts = std::move(counts);
+    res.initDisplacements();
+    return res;
+  }
+
+  /* result must have room for getTotalSize() elements on root, it's
+   * ignored on other processes */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void gather(detail::type_identity_t<ArrayRef<ScalarT>> local,
+              MutableArrayRef<ScalarT> result) const {
+    assertLocalSize(local.size());
+    assert((!is_root || result.size() >= total) &&
+           "not enough room for the gathered data");
+    auto type = TypeSelector::getHandle();
+    detail::exitOnError(MPI_Gatherv(local.data(), local.size(), type,
+                                    result.data(), counts.data(),
+                                    displs.data(), type, root, comm));
+  }
+
+  /* result is resized to getTotalSize() on root, so its storage is reused
+   * by subsequent calls. Returns true on root */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+            class Allocator>
+  bool gather(detail::type_identity_t<ArrayRef<ScalarT>> local,
+              std::vector<ScalarT, Allocator> &result) const {
+    if (is_root)
+      result.resize(total);
+    gather<ScalarT, TypeSelector>(local, MutableArrayRef<ScalarT>(result));
+    return is_root;
+  }
+
+  /* Root's own part must already be at its place in data, which has room
+   * for getTotalSize() elements. On other processes data is their part */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void gatherInPlace(MutableArrayRef<ScalarT> data) const {
+    assertInitialized();
+    assert((!is_root || data.size() >= total) &&
+           "not enough room for the gathered data");
+    if (!is_root)
+      assertLocalSize(data.size());
+    auto type = TypeSelector::getHandle();
+    /* send count and type are ignored on root */
+    detail::exitOnError(MPI_Gatherv(is_root ? MPI_IN_PLACE : data.data(),
+                                    data.size(), type, data.data(),
+                                    counts.data(), displs.data(), type, root,
+                                    comm));
+  }
+
+  /* Nonblocking gather. Plan, local and result must stay alive until
+   * returned request is completed */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  Request igather(detail::type_identity_t<ArrayRef<ScalarT>> local,
+                  MutableArrayRef<ScalarT> result) const {
+    assertLocalSize(local.size());
+    assert((!is_root || result.size() >= total) &&
+           "not enough room for the gathered data");
+    auto type = TypeSelector::getHandle();
+    MPI_Request res;
+    detail::exitOnError(MPI_Igatherv(local.data(), local.size(), type,
+                                     result.data(), counts.data(),
+                                     displs.data(), type, root, comm, &res));
+    return Request{res};
+  }
+
+private:
+  GathervPlan(int root, const Comm &comm) : VarCountLayout(root, comm) {}
+
+  void assertLocalSize(size_t sz) const {
+    (void)sz;
+    assertInitialized();
+    assert((local_count < 0 || sz == static_cast<size_t>(local_count)) &&
+           "local part doesn't match the plan");
+  }
+};
+
+/* Precomputed layout for scattering parts of variable size from root */
+class ScattervPlan : public detail::VarCountLayout {
+public:
+  /* Empty plan, has to be assigned before use */
+  ScattervPlan() = default;
+
+  /* Parts are split by splitter, each work item consists of item_size
+   * elements. Layout is the same as in scatterFair(). Doesn't communicate */
+  explicit ScattervPlan(const util::WorkSplitterLinear &splitter,
+                        int root = 0, const Comm &comm = MPI_COMM_WORLD,
+                        int item_size = 1)
+      : VarCountLayout(root, comm) {
+    initFromSplitter(splitter, item_size);
+  }
+
+  /* Collective: each process receives local_size elements */
+  static ScattervPlan fromLocalSize(size_t local_size, int root = 0,
+                                    const Comm &comm = MPI_COMM_WORLD) {
+    ScattervPlan res{root, comm};
+    res.gatherCounts(local_size);
+    return res;
+  }
+
+  /* Collective: i-th process receives counts[i] elements. counts are
+   * significant only on root */
+  static ScattervPlan fromCounts(std::vector<int> counts, int root = 0,
+                                 const Comm &comm = MPI_COMM_WORLD) {
+    ScattervPlan res{root, comm};
+    res.counts = std::move(counts);
+    res.initDisplacements();
+    detail::exitOnError(MPI_Scatter(res.counts.data(), 1, MPI_INT,
+                                    &res.local_count, 1, MPI_INT, root, comm));
+    return res;
+  }
+
+  /* Number of elements this process receives */
+  size_t getLocalSize() const {
+    assertInitialized();
+    return local_count;
+  }
+
+  /* data is significant only on root, result must have room for
+   * getLocalSize() elements */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void scatter(detail::type_identity_t<ArrayRef<ScalarT>> data,
+               MutableArrayRef<ScalarT> result) const {
+    assertArgs(data.size(), result.size());
+    auto type = TypeSelector::getHandle();
+    detail::exitOnError(MPI_Scatterv(data.data(), counts.data(),
+                                     displs.data(), type, result.data(),
+                                     local_count, type, root, comm));
+  }
+
+  /* result is resized to getLocalSize() */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+            class Allocator>
+  void scatter(detail::type_identity_t<ArrayRef<ScalarT>> data,
+               std::vector<ScalarT, Allocator> &result) const {
+    result.resize(local_count);
+    scatter<ScalarT, TypeSelector>(data, MutableArrayRef<ScalarT>(result));
+  }
+
+  /* Root's part is left in data (which holds the whole array on root) and
+   * the returned view points to it. On other processes the part is
+   * received into the beginning of data */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  MutableArrayRef<ScalarT> scatterInPlace(MutableArrayRef<ScalarT> data) const {
+    assertArgs(is_root ? data.size() : 0, data.size());
+    auto type = TypeSelector::getHandle();
+    detail::exitOnError(MPI_Scatterv(
+        data.data(), counts.data(), displs.data(), type,
+        is_root ? MPI_IN_PLACE : data.data(), local_count, type, root, comm));
+    return data.slice(is_root ? displs[root] : 0, local_count);
+  }
+
+  /* Nonblocking scatter. Plan, data and result must stay alive until
+   * returned request is completed */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  Request iscatter(detail::type_identity_t<ArrayRef<ScalarT>> data,
+                   MutableArrayRef<ScalarT> result) const {
+    assertArgs(data.size(), result.size());
+    auto type = TypeSelector::getHandle();
+    MPI_Request res;
+    detail::exitOnError(MPI_Iscatterv(data.data(), counts.data(),
+                                      displs.data(), type, result.data(),
+                                      local_count, type, root, comm, &res));
+    return Request{res};
+  }
+
+private:
+  ScattervPlan(int root, const Comm &comm) : VarCountLayout(root, comm) {}
+
+  void assertArgs(size_t data_sz, size_t result_sz) const {
+    (void)data_sz, (void)result_sz;
+    assertInitialized();
+    assert((!is_root || data_sz >= total) && "not enough data to scatter");
+    assert(result_sz >= static_cast<size_t>(local_count) &&
+           "not enough room for the received data");
+  }
+};
+
+} // namespace cxxmpi
@@ -0,0 +1,271 @@
+/* Node-aware two-level collectives
+ *
+ * Flat collectives treat all processes alike, though processes on the same
+ * node communicate through shared memory, which is much cheaper than the
+ * network. NodeHierarchy splits communicator into nodes (with
+ * MPI_Comm_split_type(MPI_COMM_TYPE_SHARED)) and picks the process with the
+ * lowest rank on each node as its leader. Collectives run intra-node stage
+ * first, and only leaders take part in the inter-node stage, so each node
+ * sends one message instead of one per process.
+ *
+ * Building hierarchy is collective and not cheap, so build it once and
+ * reuse it.
+ *
+ * Example:
+ * cxxmpi::NodeHierarchy Nodes;
+ * Nodes.bcast(cxxmpi::MutableArrayRef<double>(Coeffs), 0);
+ * while (...) {
+ *   double Residual = Nodes.allreduce(LocalResidual, cxxmpi::Max<double>{});
+ *   ...
+ * }
+ * if (auto Res = Nodes.gatherv(cxxmpi::ArrayRef<double>(Local)))
+ *   dump(Res.data());
+ */
+
+#pragma once
+
+#include "../P2P/BlockingMessages.hpp"
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+#include "CollectiveMessages.hpp"
+#include "Reduction.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <vector>
+
+namespace cxxmpi {
+namespace detail {
+
+/* Used on internal duplicate of node communicator (see getInternalComm())
+ * to deliver gathered data to root which is not a leader */
+constexpr int HierarchicalGatherTag = 32764;
+
+} // namespace detail
+
+class NodeHierarchy : public detail::NonCopyableAndMovable {
+public:
+  /* Collective over comm */
+  explicit NodeHierarchy(const Comm &comm = MPI_COMM_WORLD)
+      : comm(comm.get()), node_comm(comm.splitType()),
+        leader_comm(comm.split(node_comm.rank() == 0 ? 0 : MPI_UNDEFINED)),
+        internal_node_comm(detail::getInternalComm(node_comm)) {
+    /* node index is leader's rank in leader_comm */
+    int node_idx = isLeader() ? leader_comm.rank() : 0;
+    detail::exitOnError(MPI_Bcast(&node_idx, 1, MPI_INT, 0, node_comm));
+    node_of.resize(comm.size());
+    detail::exitOnError(MPI_Allgather(&node_idx, 1, MPI_INT, node_of.data(),
+                                      1, MPI_INT, comm));
+    num_nodes = *std::max_element(node_of.begin(), node_of.end()) + 1;
+
+    /* nodes are split with rank as a key, so rank in node is the number of
+     * lower ranks on the same node */
+    std::vector<int> node_sizes(num_nodes);
+    node_rank_of.resize(node_of.size());
+    for (size_t r = 0; r < node_of.size(); ++r)
+      node_rank_of[r] = node_sizes[node_of[r]]++;
+  }
+
+  const Comm &getComm() const { return comm; }
+  /* Processes of the current node */
+  const Comm &getNodeComm() const { return node_comm; }
+  /* Leaders of all nodes, null on other processes */
+  const Comm &getLeaderComm() const { return leader_comm; }
+
+  bool isLeader() const { return node_comm.rank() == 0; }
+  int getNumNodes() const { return num_nodes; }
+  /* Index of node, which process with rank belongs to */
+  int getNodeOf(int rank) const { return node_of[rank]; }
+
+  /* bcast range, which has the same size on all processes. Root's node
+   * gets data first, then leaders, then all other nodes */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void bcast(MutableArrayRef<ScalarT> data, int root) const {
+    int root_node = node_of[root];
+    bool on_root_node = (node_of[comm.rank()] == root_node);
+    if (on_root_node)
+      cxxmpi::bcast<ScalarT, TypeSelector>(data, getNodeRank(root),
+                                           node_comm);
+    if (isLeader())
+      cxxmpi::bcast<ScalarT, TypeSelector>(data, root_node, leader_comm);
+    if (!on_root_node)
+      cxxmpi::bcast<ScalarT, TypeSelector>(data, 0, node_comm);
+  }
+
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void bcast(ScalarT &data, int root) const {
+    bcast<ScalarT, TypeSelector>(MutableArrayRef<ScalarT>(data), root);
+  }
+
+  /* Gather ranges of different size ordered by rank, as cxxmpi::gatherv().
+   * Leaders gather parts of their nodes and send them to the leader of
+   * root's node, which restores rank order. If root is not a leader, the
+   * result takes one more intra-node hop, so prefer leaders (e.g. rank 0)
+   * as roots */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  GatherResult<ScalarT> gatherv(ArrayRef<ScalarT> local, int root = 0) const {
+    MPI_Datatype type = TypeSelector::getHandle();
+    int root_node = node_of[root];
+    bool is_root = (comm.rank() == root);
+    assert(detail::fitsInt(local.size()) &&
+           "hierarchical gatherv is limited to INT_MAX elements per node");
+    int local_count = local.size();
+
+    /* intra-node stage */
+    std::vector<int> node_counts;
+    std::vector<int> node_displs;
+    std::vector<ScalarT> node_data;
+    if (isLeader())
+      node_counts.resize(node_comm.size());
+    detail::exitOnError(MPI_Gather(&local_count, 1, MPI_INT,
+                                   node_counts.data(), 1, MPI_INT, 0,
+                                   node_comm));
+    if (isLeader()) {
+      size_t node_total = getDisplacements(node_counts, node_displs);
+      assert(detail::fitsInt(node_total) &&
+             "hierarchical gatherv is limited to INT_MAX elements per node");
+      node_data.resize(node_total);
+    }
+    detail::exitOnError(MPI_Gatherv(local.data(), local_count, type,
+                                    node_data.data(), node_counts.data(),
+                                    node_displs.data(), type, 0, node_comm));
+
+    std::vector<ScalarT> result;
+    if (isLeader())
+      gatherFromLeaders<TypeSelector>(node_counts, node_data, result,
+                                      root_node);
+
+    /* deliver result from leader to root */
+    int root_node_rank = getNodeRank(root);
+    if (root_node_rank != 0) {
+      if (is_root) {
+        Message msg =
+            mprobe(0, detail::HierarchicalGatherTag, internal_node_comm);
+        detail::mrecvIntoExpandableContainer<TypeSelector>(msg, result);
+      } else if (isLeader() && node_of[comm.rank()] == root_node) {
+        detail::sendRaw(result.data(), result.size(), type, root_node_rank,
+                        detail::HierarchicalGatherTag, internal_node_comm);
+      }
+    }
+    return is_root ? GatherResult<ScalarT>{std::move(result)}
+                   : GatherResult<ScalarT>{};
+  }
+
+  /* Gather scalar from each process */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  GatherResult<ScalarT> gather(const ScalarT &value, int root = 0) const {
+    return gatherv<ScalarT, TypeSelector>(ArrayRef<ScalarT>(value), root);
+  }
+
+  /* Elementwise allreduce: node reduce to leader, allreduce among leaders,
+   * node bcast. Order of operands differs from rank order, so op must be
+   * commutative */
+  template <class ScalarT, class Op = std::plus<ScalarT>,
+            class TypeSelector = DatatypeSelector<ScalarT>>
+  void allreduce(ArrayRef<ScalarT> values, MutableArrayRef<ScalarT> result,
+                 Op op = Op{}) const {
+    static_assert(IsCommutativeOp<Op>::value,
+                  "hierarchical allreduce requires commutative operation");
+    assert(result.size() == values.size() &&
+           "Result size must be equal to the size of values");
+    MPI_Datatype type = TypeSelector::getHandle();
+    int count = detail::getReductionCount(values.size());
+    detail::exitOnError(MPI_Reduce(values.data(), result.data(), count, type,
+                                   detail::getOp<ScalarT>(op), 0, node_comm));
+    if (isLeader())
+      detail::exitOnError(MPI_Allreduce(MPI_IN_PLACE, result.data(), count,
+                                        type, detail::getOp<ScalarT>(op),
+                                        leader_comm));
+    detail::exitOnError(MPI_Bcast(result.data(), count, type, 0, node_comm));
+  }
+
+  template <class ScalarT, class Op = std::plus<ScalarT>,
+            class TypeSelector = DatatypeSelector<ScalarT>>
+  ScalarT allreduce(const ScalarT &value, Op op = Op{}) const {
+    ScalarT result;
+    allreduce<ScalarT, Op, TypeSelector>(ArrayRef<ScalarT>(value),
+                                         MutableArrayRef<ScalarT>(result), op);
+    return result;
+  }
+
+private:
+  Comm comm;
+  Comm node_comm;
+  Comm leader_comm;
+  /* for cxxmpi's own messages, freed together with node_comm */
+  MPI_Comm internal_node_comm;
+  int num_nodes = 0;
+  /* node index and rank in node communicator of each process */
+  std::vector<int> node_of;
+  std::vector<int> node_rank_of;
+
+  int getNodeRank(int rank) const { return node_rank_of[rank]; }
+
+  static size_t getDisplacements(const std::vector<int> &counts,
+                                 std::vector<int> &displs) {
+    displs.assign(1, 0);
+    std::partial_sum(counts.begin(), counts.end() - 1,
+                     std::back_inserter(displs));
+    return displs.back() + static_cast<size_t>(counts.back());
+  }
+
+  /* Inter-node stage of gatherv(): leader of root_node receives data and
+   * counts of all nodes in node order and puts them into rank order */
+  template <class TypeSelector, class ScalarT>
+  void gatherFromLeaders(const std::vector<int> &node_counts,
+                         const std::vector<ScalarT> &node_data,
+                         std::vector<ScalarT> &result, int root_node) const {
+    MPI_Datatype type = TypeSelector::getHandle();
+    bool is_root_leader = (leader_comm.rank() == root_node);
+
+    /* sizes of nodes are known from node_of, so counts of individual
+     * processes are gathered without extra round */
+    std::vector<int> node_sizes(num_nodes);
+    for (int node : node_of)
+      ++node_sizes[node];
+    std::vector<int> counts(node_of.size());
+    std::vector<int> node_sizes_displs;
+    getDisplacements(node_sizes, node_sizes_displs);
+    detail::exitOnError(MPI_Gatherv(
+        node_counts.data(), node_counts.size(), MPI_INT, counts.data(),
+        node_sizes.data(), node_sizes_displs.data(), MPI_INT, root_node,
+        leader_comm));
+
+    int node_total = node_data.size();
+    std::vector<int> node_totals(is_root_leader ? num_nodes : 0);
+    detail::exitOnError(MPI_Gather(&node_total, 1, MPI_INT,
+                                   node_totals.data(), 1, MPI_INT, root_node,
+                                   leader_comm));
+    std::vector<int> node_displs;
+    std::vector<ScalarT> gathered;
+    if (is_root_leader) {
+      size_t total = getDisplacements(node_totals, node_displs);
+      assert(detail::fitsInt(total) &&
+             "hierarchical gatherv is limited to INT_MAX elements in total");
+      gathered.resize(total);
+    }
+    detail::exitOnError(MPI_Gatherv(node_data.data(), node_total, type,
+                                    gathered.data(), node_totals.data(),
+                                    node_displs.data(), type, root_node,
+                                    leader_comm));
+    if (!is_root_leader)
+      return;
+
+    /* parts of each node follow in rank order, so running position per
+     * node finds the part of each rank in a single pass */
+    std::vector<size_t> next_pos(node_displs.begin(), node_displs.end());
+    result.clear();
+    result.reserve(gathered.size());
+    for (size_t rank = 0; rank < node_of.size(); ++rank) {
+      int node = node_of[rank];
+      size_t sz = counts[node_sizes_displs[node] + getNodeRank(rank)];
+      auto first = gathered.begin() + next_pos[node];
+      next_pos[node] += sz;
+      result.insert(result.end(), first, first + sz);
+    }
+  }
+};
+
+} // namespace cxxmpi
@@ -0,0 +1,159 @@
+/* Neighborhood collectives over Cartesian topology
+ *
+ * Each process exchanges data only with its neighbors in CartComm (see
+ * Shared/CartComm.hpp), 2 per dimension. Halo exchange thus becomes a
+ * single call instead of a pair of sendrecv() per dimension, and MPI may
+ * optimize it as a whole.
+ *
+ * Blocks are ordered by neighbor: for each dimension the one at -1, then
+ * the one at +1. Blocks of missing neighbors (at non-periodic boundaries)
+ * are not touched.
+ *
+ * Example (1D halo exchange):
+ * auto Ring = cxxmpi::CartComm::grid(1, true);
+ * double Halo[2]; // from left and right neighbors
+ * double Border[2] = {Local.front(), Local.back()};
+ * cxxmpi::neighborAlltoall<double>(Border, Halo, Ring);
+ */
+
+#pragma once
+
+#include "../P2P/NonblockingMessages.hpp"
+#include "../Shared/CartComm.hpp"
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+
+#include <cassert>
+#include <vector>
+
+namespace cxxmpi {
+namespace detail {
+
+inline int getNeighborCount(size_t count) {
+  assert(fitsInt(count) && "Neighborhood collectives of more than INT_MAX "
+                           "elements per neighbor are not supported");
+  return static_cast<int>(count);
+}
+
+} // namespace detail
+
+/* Each neighbor gets data, result receives data.size() elements from each
+ * neighbor */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+void neighborAllgather(detail::type_identity_t<ArrayRef<ScalarT>> data,
+                       MutableArrayRef<ScalarT> result, const CartComm &comm) {
+  assert(result.size() == data.size() * comm.getNumNeighbors() &&
+         "result must have room for a block from each neighbor");
+  auto type = TypeSelector::getHandle();
+  int count = detail::getNeighborCount(data.size());
+  detail::exitOnError(MPI_Neighbor_allgather(data.data(), count, type,
+                                             result.data(), count, type,
+                                             comm));
+}
+
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+std::vector<ScalarT> neighborAllgather(ArrayRef<ScalarT> data,
+                                       const CartComm &comm) {
+  std::vector<ScalarT> result(data.size() * comm.getNumNeighbors());
+  neighborAllgather<ScalarT, TypeSelector>(data,
+                                           MutableArrayRef<ScalarT>(result),
+                                           comm);
+  return result;
+}
+
+/* i-th neighbor gets i-th block of data and result gets i-th block from
+ * it. Both are split into getNumNeighbors() blocks of the same size */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+void neighborAlltoall(detail::type_identity_t<ArrayRef<ScalarT>> data,
+                      MutableArrayRef<ScalarT> result, const CartComm &comm) {
+  size_t num_neighbors = comm.getNumNeighbors();
+  assert(data.size() == result.size() && data.size() % num_neighbors == 0 &&
+         "data and result must consist of a block per neighbor");
+  auto type = TypeSelector::getHandle();
+  int count = detail::getNeighborCount(data.size() / num_neighbors);
+  detail::exitOnError(MPI_Neighbor_alltoall(data.data(), count, type,
+                                            result.data(), count, type,
+                                            comm));
+}
+
+/* i-th neighbor gets send_counts[i] elements starting at
+ * data[send_displs[i]], and recv_counts[i] elements from it are put to
+ * result[recv_displs[i]]. Blocks may be anywhere in the buffers, e.g.
+ * border rows of a local part of a matrix can be sent without copying */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+void neighborAlltoallv(detail::type_identity_t<ArrayRef<ScalarT>> data,
+                       ArrayRef<int> send_counts, ArrayRef<int> send_displs,
+                       MutableArrayRef<ScalarT> result,
+                       ArrayRef<int> recv_counts, ArrayRef<int> recv_displs,
+                       const CartComm &comm) {
+  size_t num_neighbors = comm.getNumNeighbors();
+  (void)num_neighbors;
+  assert(send_counts.size() == num_neighbors &&
+         send_displs.size() == num_neighbors &&
+         recv_counts.size() == num_neighbors &&
+         recv_displs.size() == num_neighbors &&
+         "counts and displacements must be specified for each neighbor");
+  auto type = TypeSelector::getHandle();
+  detail::exitOnError(MPI_Neighbor_alltoallv(
+      data.data(), send_counts.data(), send_displs.data(), type,
+      result.data(), recv_counts.data(), recv_displs.data(), type, comm));
+}
+
+/* Nonblocking versions. Buffers (and counts and displacements) must stay
+ * alive and unchanged until returned request is completed */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request ineighborAllgather(detail::type_identity_t<ArrayRef<ScalarT>> data,
+                           MutableArrayRef<ScalarT> result,
+                           const CartComm &comm) {
+  assert(result.size() == data.size() * comm.getNumNeighbors() &&
+         "result must have room for a block from each neighbor");
+  auto type = TypeSelector::getHandle();
+  int count = detail::getNeighborCount(data.size());
+  MPI_Request res;
+  detail::exitOnError(MPI_Ineighbor_allgather(data.data(), count, type,
+                                              result.data(), count, type,
+                                              comm, &res));
+  return Request{res};
+}
+
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request ineighborAlltoall(detail::type_identity_t<ArrayRef<ScalarT>> data,
+                          MutableArrayRef<ScalarT> result,
+                          const CartComm &comm) {
+  size_t num_neighbors = comm.getNumNeighbors();
+  assert(data.size() == result.size() && data.size() % num_neighbors == 0 &&
+         "data and result must consist of a block per neighbor");
+  auto type = TypeSelector::getHandle();
+  int count = detail::getNeighborCount(data.size() / num_neighbors);
+  MPI_Request res;
+  detail::exitOnError(MPI_Ineighbor_alltoall(data.data(), count, type,
+                                             result.data(), count, type,
+                                             comm, &res));
+  return Request{res};
+}
+
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request ineighborAlltoallv(detail::type_identity_t<ArrayRef<ScalarT>> data,
+                           ArrayRef<int> send_counts,
+                           ArrayRef<int> send_displs,
+                           MutableArrayRef<ScalarT> result,
+                           ArrayRef<int> recv_counts,
+                           ArrayRef<int> recv_displs, const CartComm &comm) {
+  size_t num_neighbors = comm.getNumNeighbors();
+  (void)num_neighbors;
+  assert(send_counts.size() == num_neighbors &&
+         send_displs.size() == num_neighbors &&
+         recv_counts.size() == num_neighbors &&
+         recv_displs.size() == num_neighbors &&
+         "counts and displacements must be specified for each neighbor");
+  auto type = TypeSelector::getHandle();
+  MPI_Request res;
+  detail::exitOnError(MPI_Ineighbor_alltoallv(
+      data.data(), send_counts.data(), send_displs.data(), type,
+      result.data(), recv_counts.data(), recv_displs.data(), type, comm,
+      &res));
+  return Request{res};
+}
+
+} // namespace cxxmpi
@@ -0,0 +1,416 @@
+#pragma once
+
+#include "../P2P/NonblockingMessages.hpp"
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+#include "../Util/WorkSplitter.hpp"
+#include "AllToAll.hpp"
+#include "CollectiveMessages.hpp"
+#include "Reduction.hpp"
+
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace cxxmpi {
+namespace detail {
+
+/* Everything pending collective needs until completion. It lives on the
+ * heap, so buffers stay at the same address when the future is moved */
+template <class DataT> struct FutureState {
+  DataT data;
+  bool is_valid = true;
+  Request request;
+  /* Counts and displacements of v-collectives */
+  int local_count = 0;
+  std::vector<int> counts;
+  std::vector<int> displs;
+  /* Copies of send buffers */
+  std::shared_ptr<void> keep_alive;
+};
+
+} // namespace detail
+
+/* Pending nonblocking collective operation, which resolves to
+ * CommunicationResult (see CollectiveMessages.hpp)
+ *
+ * MPI progresses nonblocking collectives only inside MPI calls, so call
+ * test() from time to time while doing other work. Destructor waits for
+ * completion, since all processes must complete the collective anyway.
+ *
+ * Example:
+ * auto Snapshot = mpi::igatherv(mpi::makeArrayRef(LocalMap), 0);
+ * while (!Snapshot.test())
+ *   doSomeUsefulWork();
+ * if (auto Res = Snapshot.get())
+ *   render(Res.data());
+ */
+template <class DataT> class CommunicationFuture {
+  using State = detail::FutureState<DataT>;
+
+public:
+  CommunicationFuture() = default;
+  explicit CommunicationFuture(std::unique_ptr<State> s)
+      : state(std::move(s)) {}
+
+  CommunicationFuture(CommunicationFuture &&other) = default;
+  CommunicationFuture &operator=(CommunicationFuture &&other) {
+    if (this != &other) {
+      if (state)
+        wait();
+      state = std::move(other.state);
+    }
+    return *this;
+  }
+
+  ~CommunicationFuture() {
+    if (state)
+      wait();
+  }
+
+  /* Returns false for default-constructed future and after get() */
+  bool valid() const { return state != nullptr; }
+
+  /* Returns true if operation has completed. Never blocks */
+  bool test() {
+    assert(valid() && "Trying to test invalid future");
+    return state->request.test();
+  }
+
+  void wait() {
+    assert(valid() && "Trying to wait for invalid future");
+    state->request.wait();
+  }
+
+  /* Waits for completion and takes the result, future becomes invalid */
+  CommunicationResult<DataT> get() {
+    wait();
+    std::unique_ptr<State> s = std::move(state);
+    return s->is_valid ? CommunicationResult<DataT>{std::move(s->data)}
+                       : CommunicationResult<DataT>{};
+  }
+
+private:
+  std::unique_ptr<State> state;
+};
+
+namespace detail {
+
+template <class DataT> std::unique_ptr<FutureState<DataT>> makeFutureState() {
+  return std::unique_ptr<FutureState<DataT>>(new FutureState<DataT>);
+}
+
+inline int getNonblockingCount(size_t count) {
+  assert(fitsInt(count) && "Nonblocking collectives of more than INT_MAX "
+                           "elements are not supported");
+  return static_cast<int>(count);
+}
+
+} // namespace detail
+
+/* Nonblocking bcast of scalar. As in bcast(), data is updated in place,
+ * so it must not be accessed until returned request is completed */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request ibcast(ScalarT &data, int root, const Comm &comm = MPI_COMM_WORLD) {
+  MPI_Request res;
+  detail::exitOnError(
+      MPI_Ibcast(&data, 1, TypeSelector::getHandle(), root, comm, &res));
+  return Request{res};
+}
+
+/* Nonblocking bcast of any contiguous range
+ * Range must have the same size on all processes */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request ibcast(MutableArrayRef<ScalarT> data, int root,
+               const Comm &comm = MPI_COMM_WORLD) {
+  detail::LargeCount lc{data.size(), TypeSelector::getHandle()};
+  MPI_Request res;
+  detail::exitOnError(MPI_Ibcast(data.data(), lc.count(), lc.type(), root,
+                                 comm, &res));
+  return Request{res};
+}
+
+/* Nonblocking gather of scalar, value is copied */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationFuture<std::vector<ScalarT>>
+igather(const ScalarT &value_to_send, int root = 0,
+        const Comm &comm = MPI_COMM_WORLD) {
+  auto state = detail::makeFutureState<std::vector<ScalarT>>();
+  auto type = TypeSelector::getHandle();
+  state->is_valid = (commRank(comm) == root);
+  if (state->is_valid)
+    state->data.resize(commSize(comm));
+  auto send_buf = std::make_shared<ScalarT>(value_to_send);
+  state->keep_alive = send_buf;
+
+  MPI_Request res;
+  detail::exitOnError(MPI_Igather(send_buf.get(), 1, type, state->data.data(),
+                                  1, type, root, comm, &res));
+  state->request = Request{res};
+  return CommunicationFuture<std::vector<ScalarT>>{std::move(state)};
+}
+
+/* Nonblocking gather of contributions of variable size
+ * Sizes are gathered first with a blocking gather (a single int per
+ * process), so that the data gather is started right away: MPI requires
+ * all processes to start collectives on a communicator in the same order,
+ * which would break if it was started from test()/wait(). value_to_send
+ * must not be changed until completion */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationFuture<std::vector<ScalarT>>
+igatherv(ArrayRef<ScalarT> value_to_send, int root = 0,
+         const Comm &comm = MPI_COMM_WORLD) {
+  auto state = detail::makeFutureState<std::vector<ScalarT>>();
+  state->is_valid = (commRank(comm) == root);
+  state->local_count = detail::getNonblockingCount(value_to_send.size());
+  if (state->is_valid)
+    state->counts.resize(commSize(comm));
+
+  detail::exitOnError(MPI_Gather(&state->local_count, 1, MPI_INT,
+                                 state->counts.data(), 1, MPI_INT, root,
+                                 comm));
+  if (state->is_valid) {
+    state->displs.assign(1, 0);
+    std::partial_sum(state->counts.begin(), state->counts.end(),
+                     std::back_inserter(state->displs));
+    state->data.resize(detail::getNonblockingCount(state->displs.back()));
+  }
+
+  auto type = TypeSelector::getHandle();
+  MPI_Request res;
+  detail::exitOnError(MPI_Igatherv(value_to_send.data(), state->local_count,
+                                   type, state->data.data(),
+                                   state->counts.data(), state->displs.data(),
+                                   type, root, comm, &res));
+  state->request = Request{res};
+  return CommunicationFuture<std::vector<ScalarT>>{std::move(state)};
+}
+
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+CommunicationFuture<std::vector<ScalarT>>
+igatherv(const std::vector<ScalarT, Allocator> &value_to_send, int root = 0,
+         const Comm &comm = MPI_COMM_WORLD) {
+  return igatherv<ScalarT, TypeSelector>(ArrayRef<ScalarT>(value_to_send),
+                                         root, comm);
+}
+
+/* Nonblocking allreduce of scalar, result is valid on all processes
+ * value is copied, op must be stateless */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationFuture<ScalarT> iallreduce(const ScalarT &value, Op op = Op{},
+                                        const Comm &comm = MPI_COMM_WORLD) {
+  /* may still be running when the next reduction with the same functor
+   * type starts, so the functor can't be passed via pointer (see UserOp) */
+  static_assert(detail::IsStatelessOp<Op>::value,
+                "Nonblocking reductions require stateless functor");
+  auto state = detail::makeFutureState<ScalarT>();
+  auto value_copy = std::make_shared<ScalarT>(value);
+  state->keep_alive = value_copy;
+
+  MPI_Request res;
+  detail::exitOnError(MPI_Iallreduce(value_copy.get(), &state->data, 1,
+                                     TypeSelector::getHandle(),
+                                     detail::getOp<ScalarT>(op), comm, &res));
+  state->request = Request{res};
+  return CommunicationFuture<ScalarT>{std::move(state)};
+}
+
+/* Nonblocking elementwise allreduce, values must not be changed until
+ * completion, op must be stateless */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationFuture<std::vector<ScalarT>>
+iallreduce(ArrayRef<ScalarT> values, Op op = Op{},
+           const Comm &comm = MPI_COMM_WORLD) {
+  static_assert(detail::IsStatelessOp<Op>::value,
+                "Nonblocking reductions require stateless functor");
+  auto state = detail::makeFutureState<std::vector<ScalarT>>();
+  state->data.resize(values.size());
+
+  MPI_Request res;
+  detail::exitOnError(MPI_Iallreduce(
+      values.data(), state->data.data(),
+      detail::getNonblockingCount(values.size()), TypeSelector::getHandle(),
+      detail::getOp<ScalarT>(op), comm, &res));
+  state->request = Request{res};
+  return CommunicationFuture<std::vector<ScalarT>>{std::move(state)};
+}
+
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>, class Allocator>
+CommunicationFuture<std::vector<ScalarT>>
+iallreduce(const std::vector<ScalarT, Allocator> &values, Op op = Op{},
+           const Comm &comm = MPI_COMM_WORLD) {
+  return iallreduce<ScalarT, Op, TypeSelector>(ArrayRef<ScalarT>(values), op,
+                                               comm);
+}
+
+/* Temporary vector would be destroyed while the operation is running */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>, class Allocator>
+CommunicationFuture<std::vector<ScalarT>>
+iallreduce(const std::vector<ScalarT, Allocator> &&values, Op op = Op{},
+           const Comm &comm = MPI_COMM_WORLD) = delete;
+
+/* Nonblocking inclusive scan of scalar, value is copied, op must be
+ * stateless as in iallreduce() */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationFuture<ScalarT> iscan(const ScalarT &value, Op op = Op{},
+                                   const Comm &comm = MPI_COMM_WORLD) {
+  static_assert(detail::IsStatelessOp<Op>::value,
+                "Nonblocking reductions require stateless functor");
+  auto state = detail::makeFutureState<ScalarT>();
+  auto value_copy = std::make_shared<ScalarT>(value);
+  state->keep_alive = value_copy;
+
+  MPI_Request res;
+  detail::exitOnError(MPI_Iscan(value_copy.get(), &state->data, 1,
+                                TypeSelector::getHandle(),
+                                detail::getOp<ScalarT>(op), comm, &res));
+  state->request = Request{res};
+  return CommunicationFuture<ScalarT>{std::move(state)};
+}
+
+/* Nonblocking elementwise inclusive scan, values must not be changed until
+ * completion, op must be stateless */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationFuture<std::vector<ScalarT>>
+iscan(ArrayRef<ScalarT> values, Op op = Op{},
+      const Comm &comm = MPI_COMM_WORLD) {
+  static_assert(detail::IsStatelessOp<Op>::value,
+                "Nonblocking reductions require stateless functor");
+  auto state = detail::makeFutureState<std::vector<ScalarT>>();
+  state->data.resize(values.size());
+
+  MPI_Request res;
+  detail::exitOnError(MPI_Iscan(
+      values.data(), state->data.data(),
+      detail::getNonblockingCount(values.size()), TypeSelector::getHandle(),
+      detail::getOp<ScalarT>(op), comm, &res));
+  state->request = Request{res};
+  return CommunicationFuture<std::vector<ScalarT>>{std::move(state)};
+}
+
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>, class Allocator>
+CommunicationFuture<std::vector<ScalarT>>
+iscan(const std::vector<ScalarT, Allocator> &values, Op op = Op{},
+      const Comm &comm = MPI_COMM_WORLD) {
+  return iscan<ScalarT, Op, TypeSelector>(ArrayRef<ScalarT>(values), op, comm);
+}
+
+/* Temporary vector would be destroyed while the operation is running */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>, class Allocator>
+CommunicationFuture<std::vector<ScalarT>>
+iscan(const std::vector<ScalarT, Allocator> &&values, Op op = Op{},
+      const Comm &comm = MPI_COMM_WORLD) = delete;
+
+/* Nonblocking scatter of parts of variable size: i-th process gets counts[i]
+ * elements. data and counts are taken into account only on root, data must
+ * not be changed until completion. Counts are scattered first with a
+ * blocking scatter, since other processes don't know them (see igatherv()
+ * for why it's not deferred) */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationFuture<std::vector<ScalarT>>
+iscatterv(ArrayRef<ScalarT> data, ArrayRef<int> counts, int root,
+          const Comm &comm = MPI_COMM_WORLD) {
+  auto state = detail::makeFutureState<std::vector<ScalarT>>();
+  if (commRank(comm) == root) {
+    assert(counts.size() == static_cast<size_t>(commSize(comm)) &&
+           "counts must be specified for each process");
+    state->counts = counts.vec();
+    state->displs.assign(1, 0);
+    std::partial_sum(state->counts.begin(), state->counts.end(),
+                     std::back_inserter(state->displs));
+    assert(static_cast<size_t>(state->displs.back()) <= data.size() &&
+           "counts exceed the size of data");
+  }
+
+  detail::exitOnError(MPI_Scatter(state->counts.data(), 1, MPI_INT,
+                                  &state->local_count, 1, MPI_INT, root,
+                                  comm));
+  state->data.resize(state->local_count);
+
+  auto type = TypeSelector::getHandle();
+  MPI_Request res;
+  detail::exitOnError(MPI_Iscatterv(data.data(), state->counts.data(),
+                                    state->displs.data(), type,
+                                    state->data.data(), state->local_count,
+                                    type, root, comm, &res));
+  state->request = Request{res};
+  return CommunicationFuture<std::vector<ScalarT>>{std::move(state)};
+}
+
+/* Nonblocking version of scatterFair(). Since all processes know data_sz,
+ * the data is scattered in a single stage */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationFuture<std::vector<ScalarT>>
+iscatterFair(ArrayRef<ScalarT> data, size_t data_sz, int root,
+             const Comm &comm = MPI_COMM_WORLD) {
+  auto rank = commRank(comm);
+  assert((rank != root || data.size() == data_sz) &&
+         "passed data_sz value must match the size of the passed data");
+  auto splitter = util::WorkSplitterLinear{
+      detail::getNonblockingCount(data_sz), commSize(comm)};
+  auto state = detail::makeFutureState<std::vector<ScalarT>>();
+  state->counts = splitter.getSizes();
+  state->displs = splitter.getDisplacements();
+  state->local_count = state->counts[rank];
+  state->data.resize(state->local_count);
+
+  auto type = TypeSelector::getHandle();
+  MPI_Request res;
+  detail::exitOnError(MPI_Iscatterv(
+      data.data(), state->counts.data(), state->displs.data(), type,
+      state->data.data(), state->local_count, type, root, comm, &res));
+  state->request = Request{res};
+  return CommunicationFuture<std::vector<ScalarT>>{std::move(state)};
+}
+
+/* Nonblocking alltoall(). data and result must stay alive until returned
+ * request is completed */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request ialltoall(detail::type_identity_t<ArrayRef<ScalarT>> data,
+                  MutableArrayRef<ScalarT> result,
+                  const Comm &comm = MPI_COMM_WORLD) {
+  size_t comm_sz = comm.size();
+  assert(data.size() == result.size() && data.size() % comm_sz == 0 &&
+         "data and result must consist of a block per process");
+  auto type = TypeSelector::getHandle();
+  int count = detail::getAlltoallCount(data.size() / comm_sz);
+  MPI_Request res;
+  detail::exitOnError(MPI_Ialltoall(data.data(), count, type, result.data(),
+                                    count, type, comm, &res));
+  return Request{res};
+}
+
+/* Nonblocking alltoallv(). layout has to stay alive as well */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request ialltoallv(detail::type_identity_t<ArrayRef<ScalarT>> data,
+                   const AlltoallvLayout &layout,
+                   MutableArrayRef<ScalarT> result,
+                   const Comm &comm = MPI_COMM_WORLD) {
+  assert(layout.send_counts.size() == static_cast<size_t>(comm.size()) &&
+         "layout doesn't match the communicator");
+  assert(data.size() >= layout.getSendSize() &&
+         result.size() >= layout.getRecvSize() &&
+         "buffers are too small for the layout");
+  auto type = TypeSelector::getHandle();
+  MPI_Request res;
+  detail::exitOnError(MPI_Ialltoallv(
+      data.data(), layout.send_counts.data(), layout.send_displs.data(), type,
+      result.data(), layout.recv_counts.data(), layout.recv_displs.data(),
+      type, comm, &res));
+  return Request{res};
+}
+
+} // namespace cxxmpi
@@ -0,0 +1,463 @@
+#pragma once
+
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+#include "../Util/WorkSplitter.hpp"
+#include "CollectiveMessages.hpp"
+
+#include <cassert>
+#include <functional>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+namespace cxxmpi {
+
+/* std has no functors for min and max, these are mapped to MPI_MIN and
+ * MPI_MAX */
+template <class T> struct Min {
+  T operator()(const T &lhs, const T &rhs) const {
+    return rhs < lhs ? rhs : lhs;
+  }
+};
+
+template <class T> struct Max {
+  T operator()(const T &lhs, const T &rhs) const {
+    return lhs < rhs ? rhs : lhs;
+  }
+};
+
+/* User-defined operations are assumed to be commutative, which lets MPI
+ * choose any reduction order. Specialize this for operations which are not
+ * commutative (but still must be associative):
+ * template <> struct cxxmpi::IsCommutativeOp<MatMul> : std::false_type {};
+ */
+template <class Op> struct IsCommutativeOp : std::true_type {};
+
+namespace detail {
+
+/* Types for which MPI defines arithmetic reductions. MPI_CHAR and
+ * MPI_WCHAR are not among them, bool is only logical */
+template <class T>
+using IsCharType = std::integral_constant<
+    bool, std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+              std::is_same<T, wchar_t>::value>;
+
+template <class T>
+using IsArithmeticOpType = std::integral_constant<
+    bool, isBuiltinType<T>::value && std::is_arithmetic<T>::value &&
+              !std::is_same<T, bool>::value && !IsCharType<T>::value>;
+
+template <class T>
+using IsBitwiseOpType =
+    std::integral_constant<bool, IsArithmeticOpType<T>::value &&
+                                     std::is_integral<T>::value>;
+
+template <class T>
+using IsLogicalOpType =
+    std::integral_constant<bool, IsBitwiseOpType<T>::value ||
+                                     std::is_same<T, bool>::value>;
+
+/* Functors which carry no state, so that apply() can create them itself.
+ * Only these are allowed in nonblocking reductions (see below) */
+template <class Op>
+using IsStatelessOp =
+    std::integral_constant<bool, std::is_empty<Op>::value &&
+                                     std::is_default_constructible<Op>::value>;
+
+inline int deleteOpAttr(MPI_Comm, int, void *attr, void *) {
+  MPI_Op *op = static_cast<MPI_Op *>(attr);
+  int res = MPI_Op_free(op);
+  delete op;
+  return res;
+}
+
+/* Attributes of MPI_COMM_SELF are deleted at the very beginning of
+ * MPI_Finalize(), so op is freed there, however MPI is finalized */
+inline void freeAtFinalize(MPI_Op op) {
+  int keyval;
+  exitOnError(MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, deleteOpAttr,
+                                     &keyval, nullptr));
+  exitOnError(MPI_Comm_set_attr(MPI_COMM_SELF, keyval, new MPI_Op{op}));
+  /* attribute stays until it's deleted */
+  exitOnError(MPI_Comm_free_keyval(&keyval));
+}
+
+/* MPI_Op created once per (ScalarT, Op) pair from arbitrary functor
+ *
+ * Functor is called as dst[i] = op(src[i], dst[i]), i.e. src is the left
+ * operand as MPI requires. Stateless functors are simply constructed in
+ * apply(). MPI_User_function has no user data argument, so any other
+ * functor (with its captures) is passed via static pointer which is set
+ * right before each collective call. Thus such functors are valid only in
+ * blocking reductions, and reductions with the same functor type must not
+ * run concurrently from different threads. Op is freed by MPI_Finalize()
+ */
+template <class ScalarT, class Op> class UserOp {
+public:
+  static MPI_Op getHandle(const Op &op) {
+    current() = &op;
+    static const MPI_Op handle = create();
+    return handle;
+  }
+
+private:
+  static const Op *&current() {
+    static const Op *ptr = nullptr;
+    return ptr;
+  }
+
+  /* Plain loop over contiguous arrays, which compilers vectorize for
+   * simple functors */
+  static void apply(void *in, void *inout, int *len, MPI_Datatype *) {
+    const ScalarT *src = static_cast<const ScalarT *>(in);
+    ScalarT *dst = static_cast<ScalarT *>(inout);
+    const Op op = getFunctor(IsStatelessOp<Op>{});
+    const int n = *len;
+    for (int i = 0; i < n; ++i)
+      dst[i] = op(src[i], dst[i]);
+  }
+
+  static Op getFunctor(std::true_type) { return Op{}; }
+  static Op getFunctor(std::false_type) { return *current(); }
+
+  static MPI_Op create() {
+    MPI_Op res;
+    exitOnError(MPI_Op_create(&apply, IsCommutativeOp<Op>::value, &res));
+    freeAtFinalize(res);
+    return res;
+  }
+};
+
+/* Base of OpSelector which falls back to UserOp */
+struct UserDefinedOpSelector {};
+
+} // namespace detail
+
+/* OpSelector maps functor to MPI_Op. Standard functors over types supported
+ * by MPI are mapped to predefined operations (MPI_SUM, MPI_MAX, ...), which
+ * are typically much faster than user-defined ones. Anything else becomes
+ * cached user-defined operation (see detail::UserOp)
+ */
+template <class Op, class ScalarT, class = void>
+struct OpSelector : detail::UserDefinedOpSelector {
+  static MPI_Op getHandle(const Op &op) {
+    return detail::UserOp<ScalarT, Op>::getHandle(op);
+  }
+};
+
+#define DECLARE_OP_MAPPING(functor, condition, mpiop)                          \
+  template <class T>                                                           \
+  struct OpSelector<functor<T>, T,                                             \
+                    detail::enable_if_t<detail::condition<T>::value>> {        \
+    static MPI_Op getHandle(const functor<T> &) { return mpiop; }              \
+  };
+
+DECLARE_OP_MAPPING(std::plus, IsArithmeticOpType, MPI_SUM)
+DECLARE_OP_MAPPING(std::multiplies, IsArithmeticOpType, MPI_PROD)
+DECLARE_OP_MAPPING(Min, IsArithmeticOpType, MPI_MIN)
+DECLARE_OP_MAPPING(Max, IsArithmeticOpType, MPI_MAX)
+DECLARE_OP_MAPPING(std::logical_and, IsLogicalOpType, MPI_LAND)
+DECLARE_OP_MAPPING(std::logical_or, IsLogicalOpType, MPI_LOR)
+DECLARE_OP_MAPPING(std::bit_and, IsBitwiseOpType, MPI_BAND)
+DECLARE_OP_MAPPING(std::bit_or, IsBitwiseOpType, MPI_BOR)
+DECLARE_OP_MAPPING(std::bit_xor, IsBitwiseOpType, MPI_BXOR)
+
+#undef DECLARE_OP_MAPPING
+
+namespace detail {
+
+template <class ScalarT, class Op> MPI_Op getOp(const Op &op) {
+  return OpSelector<Op, ScalarT>::getHandle(op);
+}
+
+/* True if Op over ScalarT maps to predefined MPI operation, either by
+ * DECLARE_OP_MAPPING above or by user's OpSelector specialization */
+template <class Op, class ScalarT>
+using IsPredefinedOp = std::integral_constant<
+    bool, !std::is_base_of<UserDefinedOpSelector,
+                           OpSelector<Op, ScalarT>>::value>;
+
+/* Reductions work elementwise, so counts can't be replaced with a single
+ * large derived type (see Shared/LargeCount.hpp) */
+inline int getReductionCount(size_t count) {
+  assert(fitsInt(count) && "Reductions of more than INT_MAX elements are "
+                           "not supported");
+  return static_cast<int>(count);
+}
+
+} // namespace detail
+
+/* Reduce scalar, op defaults to sum
+ * Result is valid only on root, see description of CommunicationResult
+ *
+ * Example:
+ * if (auto Res = mpi::reduce(PartialSum))
+ *   std::cout << Res.data() << std::endl;
+ * // op must be associative, the order of applications is up to MPI
+ * auto Res = mpi::reduce(X, [](double A, double B) {
+ *   return std::max(std::abs(A), std::abs(B));
+ * });
+ * auto Res = mpi::reduce(X, Root, Comm); // sum, arguments as in gather()
+ */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationResult<ScalarT> reduce(const ScalarT &value, Op op = Op{},
+                                    int root = 0,
+                                    const Comm &comm = MPI_COMM_WORLD) {
+  ScalarT result;
+  detail::exitOnError(MPI_Reduce(&value, &result, 1, TypeSelector::getHandle(),
+                                 detail::getOp<ScalarT>(op), root, comm));
+  return commRank(comm) == root ? CommunicationResult<ScalarT>{result}
+                                : CommunicationResult<ScalarT>{};
+}
+
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationResult<ScalarT> reduce(const ScalarT &value, int root,
+                                    const Comm &comm = MPI_COMM_WORLD) {
+  return reduce<ScalarT, std::plus<ScalarT>, TypeSelector>(
+      value, std::plus<ScalarT>{}, root, comm);
+}
+
+/* Elementwise reduce of contiguous ranges
+ * values must have the same size on all processes, result must have the
+ * same size on root and is not touched on other processes */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+void reduce(ArrayRef<ScalarT> values, MutableArrayRef<ScalarT> result,
+            Op op = Op{}, int root = 0, const Comm &comm = MPI_COMM_WORLD) {
+  assert((commRank(comm) != root || result.size() == values.size()) &&
+         "Result size must be equal to the size of values");
+  detail::exitOnError(MPI_Reduce(
+      values.data(), result.data(), detail::getReductionCount(values.size()),
+      TypeSelector::getHandle(), detail::getOp<ScalarT>(op), root, comm));
+}
+
+/* Elementwise reduce of std::vector */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>, class Allocator>
+CommunicationResult<std::vector<ScalarT, Allocator>>
+reduce(const std::vector<ScalarT, Allocator> &values, Op op = Op{},
+       int root = 0, const Comm &comm = MPI_COMM_WORLD) {
+  using ResultT = CommunicationResult<std::vector<ScalarT, Allocator>>;
+  bool is_root = (commRank(comm) == root);
+  std::vector<ScalarT, Allocator> result;
+  if (is_root)
+    result.resize(values.size());
+  reduce<ScalarT, Op, TypeSelector>(values, makeMutableArrayRef(result), op,
+                                    root, comm);
+  return is_root ? ResultT{std::move(result)} : ResultT{};
+}
+
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+CommunicationResult<std::vector<ScalarT, Allocator>>
+reduce(const std::vector<ScalarT, Allocator> &values, int root,
+       const Comm &comm = MPI_COMM_WORLD) {
+  return reduce<ScalarT, std::plus<ScalarT>, TypeSelector>(
+      values, std::plus<ScalarT>{}, root, comm);
+}
+
+/* In-place elementwise reduce: result replaces data on root, data on other
+ * processes is left untouched */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+void reduceInPlace(MutableArrayRef<ScalarT> data, Op op = Op{}, int root = 0,
+                   const Comm &comm = MPI_COMM_WORLD) {
+  bool is_root = (commRank(comm) == root);
+  detail::exitOnError(MPI_Reduce(
+      is_root ? MPI_IN_PLACE : data.data(), is_root ? data.data() : nullptr,
+      detail::getReductionCount(data.size()), TypeSelector::getHandle(),
+      detail::getOp<ScalarT>(op), root, comm));
+}
+
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>, class Allocator>
+void reduceInPlace(std::vector<ScalarT, Allocator> &data, Op op = Op{},
+                   int root = 0, const Comm &comm = MPI_COMM_WORLD) {
+  reduceInPlace<ScalarT, Op, TypeSelector>(makeMutableArrayRef(data), op,
+                                           root, comm);
+}
+
+/* Reduce scalar, result is returned on all processes */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+ScalarT allreduce(const ScalarT &value, Op op = Op{},
+                  const Comm &comm = MPI_COMM_WORLD) {
+  ScalarT result;
+  detail::exitOnError(MPI_Allreduce(&value, &result, 1,
+                                    TypeSelector::getHandle(),
+                                    detail::getOp<ScalarT>(op), comm));
+  return result;
+}
+
+/* Elementwise allreduce of contiguous ranges of the same size */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+void allreduce(ArrayRef<ScalarT> values, MutableArrayRef<ScalarT> result,
+               Op op = Op{}, const Comm &comm = MPI_COMM_WORLD) {
+  assert(result.size() == values.size() &&
+         "Result size must be equal to the size of values");
+  detail::exitOnError(MPI_Allreduce(
+      values.data(), result.data(), detail::getReductionCount(values.size()),
+      TypeSelector::getHandle(), detail::getOp<ScalarT>(op), comm));
+}
+
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>, class Allocator>
+std::vector<ScalarT, Allocator>
+allreduce(const std::vector<ScalarT, Allocator> &values, Op op = Op{},
+          const Comm &comm = MPI_COMM_WORLD) {
+  std::vector<ScalarT, Allocator> result(values.size());
+  allreduce<ScalarT, Op, TypeSelector>(values, makeMutableArrayRef(result), op,
+                                       comm);
+  return result;
+}
+
+/* In-place elementwise allreduce, no extra buffer is allocated */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+void allreduceInPlace(MutableArrayRef<ScalarT> data, Op op = Op{},
+                      const Comm &comm = MPI_COMM_WORLD) {
+  detail::exitOnError(MPI_Allreduce(
+      MPI_IN_PLACE, data.data(), detail::getReductionCount(data.size()),
+      TypeSelector::getHandle(), detail::getOp<ScalarT>(op), comm));
+}
+
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>, class Allocator>
+void allreduceInPlace(std::vector<ScalarT, Allocator> &data, Op op = Op{},
+                      const Comm &comm = MPI_COMM_WORLD) {
+  allreduceInPlace<ScalarT, Op, TypeSelector>(makeMutableArrayRef(data), op,
+                                              comm);
+}
+
+/* Elementwise reduce of values (which have the same size everywhere)
+ * followed by scatter: i-th process gets counts[i] elements of the result.
+ * Cheaper than reduce() + scatter, since every process reduces only its part
+ */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+std::vector<ScalarT> reduceScatter(ArrayRef<ScalarT> values,
+                                   ArrayRef<int> counts, Op op = Op{},
+                                   const Comm &comm = MPI_COMM_WORLD) {
+  assert(counts.size() == static_cast<size_t>(commSize(comm)) &&
+         "counts must be specified for each process");
+  assert(std::accumulate(counts.begin(), counts.end(), size_t{0}) ==
+             values.size() &&
+         "counts must sum up to the size of values");
+  std::vector<ScalarT> result(counts[commRank(comm)]);
+  detail::exitOnError(MPI_Reduce_scatter(
+      values.data(), result.data(), counts.data(), TypeSelector::getHandle(),
+      detail::getOp<ScalarT>(op), comm));
+  return result;
+}
+
+/* reduceScatter() with values split between processes the same way as in
+ * scatterFair() */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+std::vector<ScalarT> reduceScatterFair(ArrayRef<ScalarT> values, Op op = Op{},
+                                       const Comm &comm = MPI_COMM_WORLD) {
+  auto counts = util::WorkSplitterLinear(
+                    detail::getReductionCount(values.size()), commSize(comm))
+                    .getSizes();
+  return reduceScatter<ScalarT, Op, TypeSelector>(values, counts, op, comm);
+}
+
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>, class Allocator>
+std::vector<ScalarT>
+reduceScatterFair(const std::vector<ScalarT, Allocator> &values, Op op = Op{},
+                  const Comm &comm = MPI_COMM_WORLD) {
+  return reduceScatterFair<ScalarT, Op, TypeSelector>(ArrayRef<ScalarT>(values),
+                                                      op, comm);
+}
+
+/* reduceScatter() with equal counts: result.size() elements per process,
+ * values.size() must be equal to result.size() * commSize() */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+void reduceScatterBlock(ArrayRef<ScalarT> values,
+                        MutableArrayRef<ScalarT> result, Op op = Op{},
+                        const Comm &comm = MPI_COMM_WORLD) {
+  assert(values.size() == result.size() * commSize(comm) &&
+         "values must contain result.size() elements per process");
+  detail::exitOnError(MPI_Reduce_scatter_block(
+      values.data(), result.data(), detail::getReductionCount(result.size()),
+      TypeSelector::getHandle(), detail::getOp<ScalarT>(op), comm));
+}
+
+/* Inclusive prefix reduction: process i gets op over values of processes
+ * 0..i (in rank order, so op needs not be commutative) */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+ScalarT scan(const ScalarT &value, Op op = Op{},
+             const Comm &comm = MPI_COMM_WORLD) {
+  ScalarT result;
+  detail::exitOnError(MPI_Scan(&value, &result, 1, TypeSelector::getHandle(),
+                               detail::getOp<ScalarT>(op), comm));
+  return result;
+}
+
+/* Elementwise inclusive prefix reduction of ranges of the same size */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+void scan(ArrayRef<ScalarT> values, MutableArrayRef<ScalarT> result,
+          Op op = Op{}, const Comm &comm = MPI_COMM_WORLD) {
+  assert(result.size() == values.size() &&
+         "Result size must be equal to the size of values");
+  detail::exitOnError(MPI_Scan(
+      values.data(), result.data(), detail::getReductionCount(values.size()),
+      TypeSelector::getHandle(), detail::getOp<ScalarT>(op), comm));
+}
+
+/* Exclusive prefix reduction: process i gets op over values of processes
+ * 0..i-1. There is nothing to reduce on process 0, so result is not valid
+ * there (see CommunicationResult). Use globalRange() for offsets */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+CommunicationResult<ScalarT> exscan(const ScalarT &value, Op op = Op{},
+                                    const Comm &comm = MPI_COMM_WORLD) {
+  ScalarT result;
+  detail::exitOnError(MPI_Exscan(&value, &result, 1,
+                                 TypeSelector::getHandle(),
+                                 detail::getOp<ScalarT>(op), comm));
+  return commRank(comm) != 0 ? CommunicationResult<ScalarT>{result}
+                             : CommunicationResult<ScalarT>{};
+}
+
+/* Elementwise exclusive prefix reduction, result is not touched on
+ * process 0 */
+template <class ScalarT, class Op = std::plus<ScalarT>,
+          class TypeSelector = DatatypeSelector<ScalarT>>
+void exscan(ArrayRef<ScalarT> values, MutableArrayRef<ScalarT> result,
+            Op op = Op{}, const Comm &comm = MPI_COMM_WORLD) {
+  assert(result.size() == values.size() &&
+         "Result size must be equal to the size of values");
+  detail::exitOnError(MPI_Exscan(
+      values.data(), result.data(), detail::getReductionCount(values.size()),
+      TypeSelector::getHandle(), detail::getOp<ScalarT>(op), comm));
+}
+
+/* Position of local chunk of local_size elements in the global array made
+ * of chunks of all processes in rank order. E.g. each process may write
+ * its part of the output at this offset without sending it to root
+ *
+ * Example:
+ * auto Range = mpi::globalRange(Local.size());
+ * File.seekp(Range.FirstIdx * sizeof(double));
+ */
+inline util::WorkRangeLinear64 globalRange(size_t local_size,
+                                           const Comm &comm = MPI_COMM_WORLD) {
+  long long size = local_size;
+  long long begin = 0;
+  detail::exitOnError(
+      MPI_Exscan(&size, &begin, 1, MPI_LONG_LONG, MPI_SUM, comm));
+  if (comm.rank() == 0)
+    begin = 0;
+  return util::WorkRangeLinear64{begin, begin + size};
+}
+
+} // namespace cxxmpi
@@ -0,0 +1,219 @@
+/* Parallel file I/O (MPI-IO)
+ *
+ * Every process reads or writes its own part of a shared file, so output
+ * doesn't have to be gathered on root and its size is not bounded by root
+ * memory. Collective versions (*All) let MPI merge requests of all
+ * processes into large contiguous accesses, prefer them.
+ *
+ * What process sees in the file is defined by view: displacement in bytes,
+ * element type (etype) and file type, which selects the elements of the
+ * file belonging to the process, e.g. a subarray of a global grid (see
+ * getSubarrayType()). Offsets are counted in etypes of the current view,
+ * i.e. in bytes by default. Data is stored in native representation.
+ *
+ * Example (distributed array is written as one file in rank order):
+ * auto Out = cxxmpi::File::openWrite("output.bin");
+ * Out.writeOrderedAll(cxxmpi::ArrayRef<double>(Local));
+ *
+ * Example (local block of 2D decomposition):
+ * auto Ty = cxxmpi::getSubarrayType(MPI_DOUBLE, GlobalSizes, LocalSizes,
+ *                                   Starts);
+ * Out.setView<double>(Ty);
+ * Out.writeAll(cxxmpi::ArrayRef<double>(Local));
+ */
+
+#pragma once
+
+#include "../Collective/Reduction.hpp"
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+#include "../Util/WorkSplitter.hpp"
+
+#include <mpi.h>
+
+#include <string>
+#include <utility>
+
+namespace cxxmpi {
+
+/* Move-only owner of MPI_File. Opening and closing are collective over the
+ * communicator */
+class File {
+public:
+  File() = default;
+
+  /* amode is a combination of MPI_MODE_* flags */
+  static File open(const std::string &path, int amode,
+                   const Comm &comm = MPI_COMM_WORLD) {
+    File res;
+    res.comm = comm.dup();
+    detail::exitOnError(MPI_File_open(res.comm, path.c_str(), amode,
+                                      MPI_INFO_NULL, &res.handle));
+    return res;
+  }
+
+  static File openRead(const std::string &path,
+                       const Comm &comm = MPI_COMM_WORLD) {
+    return open(path, MPI_MODE_RDONLY, comm);
+  }
+
+  /* Creates file or truncates existing one */
+  static File openWrite(const std::string &path,
+                        const Comm &comm = MPI_COMM_WORLD) {
+    File res = open(path, MPI_MODE_CREATE | MPI_MODE_WRONLY, comm);
+    res.setSize(0);
+    return res;
+  }
+
+  File(const File &other) = delete;
+  File &operator=(const File &other) = delete;
+
+  File(File &&other) : comm(std::move(other.comm)), handle(other.handle) {
+    other.handle = MPI_FILE_NULL;
+  }
+
+  File &operator=(File &&other) {
+    File tmp{std::move(other)};
+    std::swap(comm, tmp.comm);
+    std::swap(handle, tmp.handle);
+    return *this;
+  }
+
+  ~File() {
+    int is_finalized;
+    MPI_Finalized(&is_finalized);
+    if (handle != MPI_FILE_NULL && !is_finalized)
+      MPI_File_close(&handle);
+  }
+
+  MPI_File getHandle() const { return handle; }
+  operator MPI_File() const { return handle; }
+  bool isNull() const { return handle == MPI_FILE_NULL; }
+  const Comm &getComm() const { return comm; }
+
+  /* Size in bytes */
+  MPI_Offset getSize() const {
+    MPI_Offset res;
+    detail::exitOnError(MPI_File_get_size(handle, &res));
+    return res;
+  }
+  /* Collective */
+  void setSize(MPI_Offset size) {
+    detail::exitOnError(MPI_File_set_size(handle, size));
+  }
+
+  /* Collective. Process sees elements of filetype starting at disp bytes,
+   * offsets are counted in ScalarT */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void setView(Datatype filetype, MPI_Offset disp = 0) {
+    char representation[] = "native";
+    detail::exitOnError(MPI_File_set_view(handle, disp,
+                                          TypeSelector::getHandle(),
+                                          filetype.getHandle(),
+                                          representation, MPI_INFO_NULL));
+  }
+
+  /* The whole file starting at disp bytes is seen as array of ScalarT */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void setView(MPI_Offset disp = 0) {
+    setView<ScalarT, TypeSelector>(TypeSelector::getHandle(), disp);
+  }
+
+  /* Process sees only range of array of ScalarT stored at disp bytes, e.g.
+   * its part given by WorkSplitterLinear or globalRange(). Offset 0 is the
+   * beginning of the range */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+            class IndexT>
+  void setView(util::BasicWorkRangeLinear<IndexT> range,
+               MPI_Offset disp = 0) {
+    setView<ScalarT, TypeSelector>(disp + range.FirstIdx *
+                                              getExtent<TypeSelector>());
+  }
+
+  /* Write data at offset (in etypes of the view) */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void writeAt(ArrayRef<ScalarT> data, MPI_Offset offset) {
+    detail::LargeCount lc{data.size(), TypeSelector::getHandle()};
+    detail::exitOnError(MPI_File_write_at(handle, offset, data.data(),
+                                          lc.count(), lc.type(),
+                                          MPI_STATUS_IGNORE));
+  }
+
+  /* Collective version of writeAt() */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void writeAtAll(ArrayRef<ScalarT> data, MPI_Offset offset) {
+    detail::LargeCount lc{data.size(), TypeSelector::getHandle()};
+    detail::exitOnError(MPI_File_write_at_all(handle, offset, data.data(),
+                                              lc.count(), lc.type(),
+                                              MPI_STATUS_IGNORE));
+  }
+
+  /* Fill result with data at offset (in etypes of the view) */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void readAt(MutableArrayRef<ScalarT> result, MPI_Offset offset) {
+    detail::LargeCount lc{result.size(), TypeSelector::getHandle()};
+    detail::exitOnError(MPI_File_read_at(handle, offset, result.data(),
+                                         lc.count(), lc.type(),
+                                         MPI_STATUS_IGNORE));
+  }
+
+  /* Collective version of readAt() */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void readAtAll(MutableArrayRef<ScalarT> result, MPI_Offset offset) {
+    detail::LargeCount lc{result.size(), TypeSelector::getHandle()};
+    detail::exitOnError(MPI_File_read_at_all(handle, offset, result.data(),
+                                             lc.count(), lc.type(),
+                                             MPI_STATUS_IGNORE));
+  }
+
+  /* Collective, at the individual file pointer, which is moved past the
+   * data. After setView() it's at the beginning of the view */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void writeAll(ArrayRef<ScalarT> data) {
+    detail::LargeCount lc{data.size(), TypeSelector::getHandle()};
+    detail::exitOnError(MPI_File_write_all(handle, data.data(), lc.count(),
+                                           lc.type(), MPI_STATUS_IGNORE));
+  }
+
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void readAll(MutableArrayRef<ScalarT> result) {
+    detail::LargeCount lc{result.size(), TypeSelector::getHandle()};
+    detail::exitOnError(MPI_File_read_all(handle, result.data(), lc.count(),
+                                          lc.type(), MPI_STATUS_IGNORE));
+  }
+
+  /* Collective. Data of all processes is written one after another in
+   * rank order starting at disp bytes. Unlike MPI_File_write_ordered() no
+   * shared file pointer is involved, offsets are found by a single scan.
+   * Sets view of ScalarT at disp */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void writeOrderedAll(ArrayRef<ScalarT> data, MPI_Offset disp = 0) {
+    auto range = globalRange(data.size(), comm);
+    setView<ScalarT, TypeSelector>(disp);
+    writeAtAll<ScalarT, TypeSelector>(data, range.FirstIdx);
+  }
+
+  /* Counterpart of writeOrderedAll(), each process reads result.size()
+   * elements following the parts of lower ranks */
+  template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+  void readOrderedAll(MutableArrayRef<ScalarT> result, MPI_Offset disp = 0) {
+    auto range = globalRange(result.size(), comm);
+    setView<ScalarT, TypeSelector>(disp);
+    readAtAll<ScalarT, TypeSelector>(result, range.FirstIdx);
+  }
+
+private:
+  /* duplicate of the communicator, for scans in ordered operations */
+  Comm comm{MPI_COMM_NULL};
+  MPI_File handle = MPI_FILE_NULL;
+
+  template <class TypeSelector> static MPI_Offset getExtent() {
+    MPI_Aint lb, extent;
+    detail::exitOnError(
+        MPI_Type_get_extent(TypeSelector::getHandle(), &lb, &extent));
+    return extent;
+  }
+};
+
+} // namespace cxxmpi
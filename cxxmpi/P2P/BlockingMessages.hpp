@@ -1,20 +1,89 @@
 #pragma once
 
+#include "../Shared/GridView.hpp"
 #include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
 #include "../Support/Utilities.hpp"
 
 #include <array>
+#include <cassert>
 #include <string>
 #include <vector>
 
 namespace cxxmpi {
 
-Status probe(int src, int tag = MPI_ANY_TAG, MPI_Comm comm = MPI_COMM_WORLD) {
+inline Status probe(int src, int tag = MPI_ANY_TAG,
+                    const Comm &comm = MPI_COMM_WORLD) {
   MPI_Status res;
   detail::exitOnError(MPI_Probe(src, tag, comm, &res));
   return res;
 }
 
+/* Message matched by mprobe() or improbe()
+ *
+ * Matched message is removed from the matching queue, so it can be
+ * received only via mrecv() and no other thread (or other probe + recv
+ * pair) can steal it in between. Null message means that nothing was
+ * matched (see improbe())
+ */
+class Message {
+public:
+  Message() : handle(MPI_MESSAGE_NULL) {}
+  Message(MPI_Message m, MPI_Status s) : handle(m), msg_status(s) {}
+
+  bool isNull() const { return handle == MPI_MESSAGE_NULL; }
+  operator bool() const { return !isNull(); }
+
+  const Status &status() const { return msg_status; }
+
+  MPI_Message getHandle() const { return handle; }
+  MPI_Message &getHandleRef() { return handle; }
+
+private:
+  MPI_Message handle;
+  Status msg_status;
+};
+
+/* Blocks until a matching message arrives */
+inline Message mprobe(int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+                      const Comm &comm = MPI_COMM_WORLD) {
+  MPI_Message msg;
+  MPI_Status status;
+  detail::exitOnError(MPI_Mprobe(src, tag, comm, &msg, &status));
+  return Message{msg, status};
+}
+
+/* Doesn't block. Returns null Message if there is no matching message */
+inline Message improbe(int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+                       const Comm &comm = MPI_COMM_WORLD) {
+  MPI_Message msg;
+  MPI_Status status;
+  int flag;
+  detail::exitOnError(MPI_Improbe(src, tag, comm, &flag, &msg, &status));
+  return flag ? Message{msg, status} : Message{};
+}
+
+namespace detail {
+
+/* All array-like data goes through these, so that sizes above INT_MAX are
+ * never narrowed (see Shared/LargeCount.hpp) */
+inline void sendRaw(const void *data, size_t count, MPI_Datatype type, int dst,
+                    int tag, const Comm &comm) {
+  LargeCount lc{count, type};
+  exitOnError(MPI_Send(data, lc.count(), lc.type(), dst, tag, comm));
+}
+
+inline TypedStatus recvRaw(void *data, size_t count, MPI_Datatype type,
+                           int src, int tag, const Comm &comm) {
+  LargeCount lc{count, type};
+  MPI_Status status;
+  exitOnError(
+      MPI_Recv(data, lc.count(), lc.type(), src, tag, comm, &status));
+  return TypedStatus{status, type};
+}
+
+} // namespace detail
+
 /* Send scalar
  * ScalarT could be
  * - Elementary type (cxxmpi::isBuiltinType<ScalarT>::value == true)
@@ -24,12 +93,13 @@ Status probe(int src, int tag = MPI_ANY_TAG, MPI_Comm comm = MPI_COMM_WORLD) {
  * - Anything else, for which you can explicitly provide TypeSelector.
  *   Note, that providing such is quite tricky for arrays with unknown length,
  *   so consider using send() version which takes array-like data (see below)
- *   If you need to send array of arrays, or a structure containing array,
- * consider sending multiple messages
+ *   If you need to send array of arrays, or a structure containing
+ * dynamic data (strings, vectors, maps), use sendPacked() (see
+ * P2P/PackedMessages.hpp) which transmits it as a single message
  */
 template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
 void send(const ScalarT &data, int dst, int tag = 0,
-          MPI_Comm comm = MPI_COMM_WORLD) {
+          const Comm &comm = MPI_COMM_WORLD) {
   detail::exitOnError(
       MPI_Send(&data, 1, TypeSelector::getHandle(), dst, tag, comm));
 }
@@ -39,27 +109,26 @@ void send(const ScalarT &data, int dst, int tag = 0,
 template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
           class Allocator>
 void send(const std::vector<ScalarT, Allocator> &data, int dst, int tag = 0,
-          MPI_Comm comm = MPI_COMM_WORLD) {
-  detail::exitOnError(MPI_Send(data.data(), data.size(),
-                               TypeSelector::getHandle(), dst, tag, comm));
+          const Comm &comm = MPI_COMM_WORLD) {
+  detail::sendRaw(data.data(), data.size(), TypeSelector::getHandle(), dst, tag,
+                  comm);
 }
 
 /* Send std::array */
 template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
           size_t N>
 void send(const std::array<ScalarT, N> &data, int dst, int tag = 0,
-          MPI_Comm comm = MPI_COMM_WORLD) {
-  detail::exitOnError(MPI_Send(data.data(), data.size(),
-                               TypeSelector::getHandle(), dst, tag, comm));
+          const Comm &comm = MPI_COMM_WORLD) {
+  detail::sendRaw(data.data(), data.size(), TypeSelector::getHandle(), dst, tag,
+                  comm);
 }
 
 /* Send C-array */
 template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
           size_t N>
 void send(const ScalarT (&data)[N], int dst, int tag = 0,
-          MPI_Comm comm = MPI_COMM_WORLD) {
-  detail::exitOnError(
-      MPI_Send(data, N, TypeSelector::getHandle(), dst, tag, comm));
+          const Comm &comm = MPI_COMM_WORLD) {
+  detail::sendRaw(data, N, TypeSelector::getHandle(), dst, tag, comm);
 }
 
 /* Send std::basic_string
@@ -71,21 +140,47 @@ void send(const ScalarT (&data)[N], int dst, int tag = 0,
 template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
           class Traits, class Allocator>
 void send(const std::basic_string<CharT, Traits, Allocator> &s, int dst,
-          int tag = 0, MPI_Comm comm = MPI_COMM_WORLD) {
-  detail::exitOnError(
-      MPI_Send(s.data(), s.size(), TypeSelector::getHandle(), dst, tag, comm));
+          int tag = 0, const Comm &comm = MPI_COMM_WORLD) {
+  detail::sendRaw(s.data(), s.size(), TypeSelector::getHandle(), dst, tag,
+                  comm);
+}
+
+/* Send any contiguous range, e.g. a part of a bigger buffer, with no
+ * copying. ArrayRef could be created from std::vector, std::array, C-array
+ * or a pair of pointers, see cxxmpi/Support/ArrayRef.hpp */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+void send(ArrayRef<ScalarT> data, int dst, int tag = 0,
+          const Comm &comm = MPI_COMM_WORLD) {
+  detail::sendRaw(data.data(), data.size(), TypeSelector::getHandle(), dst, tag,
+                  comm);
+}
+
+/* Without this overload MutableArrayRef would be sent as a scalar */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+void send(MutableArrayRef<ScalarT> data, int dst, int tag = 0,
+          const Comm &comm = MPI_COMM_WORLD) {
+  send<ScalarT, TypeSelector>(ArrayRef<ScalarT>(data), dst, tag, comm);
 }
 
 /* Send single data element with user-specified data type */
 inline void send(const void *data, Datatype type, int dst, int tag = 0,
-                 MPI_Comm comm = MPI_COMM_WORLD) {
+                 const Comm &comm = MPI_COMM_WORLD) {
   detail::exitOnError(MPI_Send(data, 1, type.getHandle(), dst, tag, comm));
 }
 
+/* Send 2D block of a grid (see Shared/GridView.hpp) directly from its
+ * storage, without packing */
+template <class T, class TypeSelector =
+                       DatatypeSelector<typename GridView<T>::value_type>>
+void send(GridView<T> data, int dst, int tag = 0,
+          const Comm &comm = MPI_COMM_WORLD) {
+  send(data.data(), data.template getType<TypeSelector>(), dst, tag, comm);
+}
+
 /* receive scalar */
 template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
 void recv(ScalarT &data, int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
-          MPI_Comm comm = MPI_COMM_WORLD,
+          const Comm &comm = MPI_COMM_WORLD,
           MPI_Status *status = MPI_STATUS_IGNORE) {
   detail::exitOnError(
       MPI_Recv(&data, 1, TypeSelector::getHandle(), src, tag, comm, status));
@@ -93,40 +188,56 @@ void recv(ScalarT &data, int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
 
 namespace detail {
 
+template <class ScalarT, class Allocator>
+ScalarT *getWritableData(std::vector<ScalarT, Allocator> &data) {
+  return data.data();
+}
+
+template <class CharT, class Traits, class Allocator>
+CharT *getWritableData(std::basic_string<CharT, Traits, Allocator> &data) {
+  return &data[0];
+}
+
 template <class TypeSelector, class Container>
-TypedStatus recvIntoExpandableContainer(Container &data, int src, int tag,
-                                        MPI_Comm comm) {
+TypedStatus mrecvIntoExpandableContainer(Message &msg, Container &data) {
   using ScalarT = typename Container::value_type;
 
+  assert(!msg.isNull() && "Trying to receive null message");
   auto initial_sz = data.size();
+  size_t msg_sz = msg.status().getCountAs<ScalarT, TypeSelector>();
+  data.resize(initial_sz + msg_sz);
 
-  /* wait + expand */
-  Status status = probe(src, tag, comm);
-  size_t msg_sz = status.getCountAs<ScalarT, TypeSelector>();
-  data.resize(data.size() + msg_sz);
-  /* receive data */
   MPI_Datatype type = TypeSelector::getHandle();
-  /* note that we must use source and tag from Status. It is necessary
-   * to handle a case when source == MPI_ANY_SOURCE and/or tag == MPI_ANY_TAG,
-   * because we may accidentally receive the wrong message (which
-   * probably requires other buffer size) */
-  detail::exitOnError(
-      MPI_Recv(&data[0] + initial_sz, msg_sz, type, status.source(), status.tag(), comm, nullptr));
-  return TypedStatus{status.getRaw(), type};
+  LargeCount lc{msg_sz, type};
+  MPI_Status status;
+  exitOnError(MPI_Mrecv(getWritableData(data) + initial_sz, lc.count(),
+                        lc.type(), &msg.getHandleRef(), &status));
+  return TypedStatus{status, type};
+}
+
+template <class TypeSelector, class Container>
+TypedStatus recvIntoExpandableContainer(Container &data, int src, int tag,
+                                        const Comm &comm) {
+  /* Matched probe guarantees that we receive exactly the message which
+   * was probed, even if source == MPI_ANY_SOURCE and/or tag == MPI_ANY_TAG
+   * and other threads are receiving on the same communicator */
+  Message msg = mprobe(src, tag, comm);
+  return mrecvIntoExpandableContainer<TypeSelector>(msg, data);
 }
 
 } // namespace detail
 
 /* Receive std::vector
  * Received data is appended to data (dynamic extension policy)
- * MPI_Probe will be called before MPI_Recv to get message length
+ * MPI_Mprobe will be called before MPI_Mrecv to get message length
  * Number of appended elements could be checked via returned Status
+ * Pass cxxmpi::Buffer to avoid zero-filling of the appended elements
  */
 template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
           class Allocator>
 TypedStatus recv(std::vector<ScalarT, Allocator> &data,
                  int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
-                 MPI_Comm comm = MPI_COMM_WORLD) {
+                 const Comm &comm = MPI_COMM_WORLD) {
   return detail::recvIntoExpandableContainer<TypeSelector>(data, src, tag,
                                                            comm);
 }
@@ -136,16 +247,272 @@ template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
           class Traits, class Allocator>
 TypedStatus recv(std::basic_string<CharT, Traits, Allocator> &data,
                  int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
-                 MPI_Comm comm = MPI_COMM_WORLD) {
+                 const Comm &comm = MPI_COMM_WORLD) {
   return detail::recvIntoExpandableContainer<TypeSelector>(data, src, tag,
                                                            comm);
 }
 
+/* Receive message matched by mprobe()/improbe() into std::vector
+ * Data is appended the same way as in recv() */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+TypedStatus mrecv(Message &msg, std::vector<ScalarT, Allocator> &data) {
+  return detail::mrecvIntoExpandableContainer<TypeSelector>(msg, data);
+}
+
+/* Receive message matched by mprobe()/improbe() into std::basic_string */
+template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
+          class Traits, class Allocator>
+TypedStatus mrecv(Message &msg,
+                  std::basic_string<CharT, Traits, Allocator> &data) {
+  return detail::mrecvIntoExpandableContainer<TypeSelector>(msg, data);
+}
+
+namespace detail {
+
+template <class TypeSelector, class Container>
+bool tryRecvIntoExpandableContainer(Container &data, int src, int tag,
+                                    const Comm &comm, MPI_Status *status) {
+  Message msg = improbe(src, tag, comm);
+  if (!msg)
+    return false;
+  auto res = mrecvIntoExpandableContainer<TypeSelector>(msg, data);
+  if (status != MPI_STATUS_IGNORE)
+    *status = res.getRaw();
+  return true;
+}
+
+} // namespace detail
+
+/* Nonblocking version of recv() for std::vector and std::basic_string
+ * If there is no matching message, returns false and leaves data untouched.
+ * Otherwise receives message the same way as recv() and returns true
+ *
+ * Example:
+ * std::vector<double> Buf;
+ * while (!cxxmpi::tryRecv(Buf, 0))
+ *   doSomeUsefulWork();
+ */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+bool tryRecv(std::vector<ScalarT, Allocator> &data, int src = MPI_ANY_SOURCE,
+             int tag = MPI_ANY_TAG, const Comm &comm = MPI_COMM_WORLD,
+             MPI_Status *status = MPI_STATUS_IGNORE) {
+  return detail::tryRecvIntoExpandableContainer<TypeSelector>(data, src, tag,
+                                                              comm, status);
+}
+
+template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
+          class Traits, class Allocator>
+bool tryRecv(std::basic_string<CharT, Traits, Allocator> &data,
+             int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+             const Comm &comm = MPI_COMM_WORLD,
+             MPI_Status *status = MPI_STATUS_IGNORE) {
+  return detail::tryRecvIntoExpandableContainer<TypeSelector>(data, src, tag,
+                                                              comm, status);
+}
+
+/* Receives count messages of any size one by one, in the order they are
+ * matched, and passes each of them to the handler together with its Status
+ * Handler signature: void(Container Data, const TypedStatus &Status)
+ *
+ * Example (root collects two tagged strings from each process):
+ * cxxmpi::recvMessages<std::string>(
+ *     2 * CommSz, [&](std::string Buf, const cxxmpi::TypedStatus &Status) {
+ *       Results[Status.tag()][Status.source()] = std::move(Buf);
+ *     });
+ */
+template <class Container,
+          class TypeSelector = DatatypeSelector<typename Container::value_type>,
+          class Handler>
+void recvMessages(size_t count, Handler handler, int src = MPI_ANY_SOURCE,
+                  int tag = MPI_ANY_TAG, const Comm &comm = MPI_COMM_WORLD) {
+  for (size_t i = 0; i < count; ++i) {
+    Container data;
+    Message msg = mprobe(src, tag, comm);
+    auto status = detail::mrecvIntoExpandableContainer<TypeSelector>(msg, data);
+    handler(std::move(data), status);
+  }
+}
+
+/* Receive into any contiguous range, e.g. a part of a bigger buffer
+ * Unlike std::vector version, range is never extended: it must have room
+ * for the whole message. Number of received elements could be checked via
+ * returned Status */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+TypedStatus recv(MutableArrayRef<ScalarT> data, int src = MPI_ANY_SOURCE,
+                 int tag = MPI_ANY_TAG, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::recvRaw(data.data(), data.size(), TypeSelector::getHandle(),
+                         src, tag, comm);
+}
+
 /* receive single */
 inline void recv(void *data, Datatype type, int src = MPI_ANY_SOURCE,
-                 int tag = MPI_ANY_TAG, MPI_Comm comm = MPI_COMM_WORLD,
+                 int tag = MPI_ANY_TAG, const Comm &comm = MPI_COMM_WORLD,
                  MPI_Status *status = MPI_STATUS_IGNORE) {
   detail::exitOnError(MPI_Recv(data, 1, type.getHandle(), src, tag, comm, status));
 }
 
+/* Receive into 2D block of a grid. Sender's layout may differ, only the
+ * number of elements must match */
+template <class T, class TypeSelector = DatatypeSelector<T>>
+void recv(GridView<T> data, int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+          const Comm &comm = MPI_COMM_WORLD,
+          MPI_Status *status = MPI_STATUS_IGNORE) {
+  recv(data.data(), data.template getType<TypeSelector>(), src, tag, comm,
+       status);
+}
+
+namespace detail {
+
+inline TypedStatus sendrecvRaw(const void *send_data, size_t send_count,
+                               int dst, void *recv_data, size_t recv_count,
+                               int src, MPI_Datatype type, int tag,
+                               const Comm &comm) {
+  LargeCount send_lc{send_count, type};
+  LargeCount recv_lc{recv_count, type};
+  MPI_Status status;
+  exitOnError(MPI_Sendrecv(send_data, send_lc.count(), send_lc.type(), dst,
+                           tag, recv_data, recv_lc.count(), recv_lc.type(),
+                           src, tag, comm, &status));
+  return TypedStatus{status, type};
+}
+
+inline TypedStatus sendrecvReplaceRaw(void *data, size_t count, int dst,
+                                      int src, MPI_Datatype type, int tag,
+                                      const Comm &comm) {
+  LargeCount lc{count, type};
+  MPI_Status status;
+  exitOnError(MPI_Sendrecv_replace(data, lc.count(), lc.type(), dst, tag, src,
+                                   tag, comm, &status));
+  return TypedStatus{status, type};
+}
+
+} // namespace detail
+
+/* Send and receive in one call
+ * Unlike a pair of send() + recv(), it never deadlocks, so shifts along a
+ * ring or a chain cost one round trip and don't require any rank-parity
+ * ordering. The same tag is used for both messages.
+ *
+ * dst and/or src may be MPI_PROC_NULL (e.g. at the ends of a chain), in
+ * this case the corresponding part of communication is skipped, receive
+ * buffer is left untouched and received count is 0
+ */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+TypedStatus sendrecv(const ScalarT &send_data, int dst, ScalarT &recv_data,
+                     int src, int tag = 0, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendrecvRaw(&send_data, 1, dst, &recv_data, 1, src,
+                             TypeSelector::getHandle(), tag, comm);
+}
+
+/* sendrecv std::vector
+ * recv_data is NOT extended, it must already have room for the message.
+ * Number of received elements could be checked via returned Status */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+TypedStatus sendrecv(const std::vector<ScalarT, Allocator> &send_data,
+                     int dst, std::vector<ScalarT, Allocator> &recv_data,
+                     int src, int tag = 0, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendrecvRaw(send_data.data(), send_data.size(), dst,
+                             recv_data.data(), recv_data.size(), src,
+                             TypeSelector::getHandle(), tag, comm);
+}
+
+/* sendrecv std::array */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          size_t N>
+TypedStatus sendrecv(const std::array<ScalarT, N> &send_data, int dst,
+                     std::array<ScalarT, N> &recv_data, int src, int tag = 0,
+                     const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendrecvRaw(send_data.data(), N, dst, recv_data.data(), N,
+                             src, TypeSelector::getHandle(), tag, comm);
+}
+
+/* sendrecv any contiguous ranges */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+TypedStatus sendrecv(ArrayRef<ScalarT> send_data, int dst,
+                     MutableArrayRef<ScalarT> recv_data, int src, int tag = 0,
+                     const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendrecvRaw(send_data.data(), send_data.size(), dst,
+                             recv_data.data(), recv_data.size(), src,
+                             TypeSelector::getHandle(), tag, comm);
+}
+
+namespace detail {
+
+template <class TypeSelector, class SendT, class RecvT>
+TypedStatus sendrecvViews(GridView<SendT> send_data, int dst,
+                          GridView<RecvT> recv_data, int src, int tag,
+                          const Comm &comm) {
+  MPI_Datatype send_type =
+      send_data.template getType<TypeSelector>().getHandle();
+  MPI_Datatype recv_type =
+      recv_data.template getType<TypeSelector>().getHandle();
+  MPI_Status status;
+  exitOnError(MPI_Sendrecv(send_data.data(), 1, send_type, dst, tag,
+                           recv_data.data(), 1, recv_type, src, tag, comm,
+                           &status));
+  /* count is reported in elements, not in view types */
+  return TypedStatus{status, TypeSelector::getHandle()};
+}
+
+} // namespace detail
+
+/* sendrecv 2D blocks of grids, e.g. halo exchange in 2D decomposition.
+ * Blocks may have different layouts but the same number of elements */
+template <class T, class TypeSelector = DatatypeSelector<T>>
+TypedStatus sendrecv(GridView<T> send_data, int dst, GridView<T> recv_data,
+                     int src, int tag = 0,
+                     const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendrecvViews<TypeSelector>(send_data, dst, recv_data, src,
+                                             tag, comm);
+}
+
+/* The same for view of const elements as the send block */
+template <class T, class TypeSelector = DatatypeSelector<T>>
+TypedStatus sendrecv(GridView<const T> send_data, int dst,
+                     GridView<T> recv_data, int src, int tag = 0,
+                     const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendrecvViews<TypeSelector>(send_data, dst, recv_data, src,
+                                             tag, comm);
+}
+
+/* Send data to dst and replace it with data received from src
+ * Uses a single buffer, so message from src must have the same length.
+ * MPI_PROC_NULL is handled the same way as in sendrecv() */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+TypedStatus sendrecvReplace(ScalarT &data, int dst, int src, int tag = 0,
+                            const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendrecvReplaceRaw(&data, 1, dst, src,
+                                    TypeSelector::getHandle(), tag, comm);
+}
+
+/* sendrecvReplace std::vector */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+TypedStatus sendrecvReplace(std::vector<ScalarT, Allocator> &data, int dst,
+                            int src, int tag = 0,
+                            const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendrecvReplaceRaw(data.data(), data.size(), dst, src,
+                                    TypeSelector::getHandle(), tag, comm);
+}
+
+/* sendrecvReplace std::array */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          size_t N>
+TypedStatus sendrecvReplace(std::array<ScalarT, N> &data, int dst, int src,
+                            int tag = 0, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendrecvReplaceRaw(data.data(), N, dst, src,
+                                    TypeSelector::getHandle(), tag, comm);
+}
+
+/* sendrecvReplace any contiguous range */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+TypedStatus sendrecvReplace(MutableArrayRef<ScalarT> data, int dst, int src,
+                            int tag = 0, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendrecvReplaceRaw(data.data(), data.size(), dst, src,
+                                    TypeSelector::getHandle(), tag, comm);
+}
+
 } // namespace cxxmpi
\ No newline at end of file
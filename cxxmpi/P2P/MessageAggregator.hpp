@@ -0,0 +1,201 @@
+#pragma once
+
+#include "../Shared/Serialization.hpp"
+#include "../Shared/misc.hpp"
+#include "../Support/DefaultInitAllocator.hpp"
+#include "../Support/Utilities.hpp"
+#include "BlockingMessages.hpp"
+#include "NonblockingMessages.hpp"
+#include "PackedMessages.hpp"
+
+#include <cassert>
+#include <deque>
+#include <vector>
+
+namespace cxxmpi {
+namespace detail {
+
+constexpr int AggregatorTag = 32766;
+
+} // namespace detail
+
+/* Batches small messages per destination into a single wire message
+ *
+ * send() only serializes object (see Shared/Serialization.hpp) into the
+ * buffer of its destination. Buffer is sent when it grows above threshold
+ * or on explicit flush(). recv() takes batches apart and returns logical
+ * messages one by one, matching them by source and tag the same way as
+ * plain recv() does. Messages from one source with the same tag are never
+ * reordered.
+ *
+ * All processes exchanging messages must use MessageAggregator with the same
+ * communicator and wire tag. Batches travel through internal duplicate of
+ * the communicator (see getInternalComm()), so they never meet user's
+ * messages, and the first aggregator over a communicator must be created
+ * collectively. recv() flushes all buffers before blocking, so two
+ * processes exchanging messages through aggregators don't deadlock. Batches
+ * are sent with nonblocking sends, destructor waits for them.
+ *
+ * Example:
+ * cxxmpi::MessageAggregator Agg;
+ * for (auto &Item : Items)
+ *   Agg.send(Item, ownerOf(Item));
+ * Agg.flush();
+ * ...
+ * while (...) {
+ *   auto Status = Agg.recv(Item);
+ *   ...
+ * }
+ */
+class MessageAggregator : public detail::NonCopyableAndMovable {
+public:
+  static constexpr size_t DefaultThreshold = 8192;
+
+  explicit MessageAggregator(const Comm &comm = MPI_COMM_WORLD,
+                             size_t threshold = DefaultThreshold,
+                             int wire_tag = detail::AggregatorTag)
+      : comm(detail::getInternalComm(comm)), threshold(threshold),
+        wire_tag(wire_tag), outgoing(commSize(comm)) {}
+
+  ~MessageAggregator() {
+    flush();
+    wait();
+  }
+
+  /* Queues obj for dst. tag must be non-negative */
+  template <class T> void send(const T &obj, int dst, int tag = 0) {
+    assert(dst >= 0 && static_cast<size_t>(dst) < outgoing.size() &&
+           "Invalid destination");
+    assert(tag >= 0 && "Negative tags are reserved for wildcards");
+    /* payload is packed separately, since its size goes first */
+    scratch.clear();
+    pack(obj, scratch);
+
+    Buffer<char> &out = outgoing[dst];
+    Packer p{out};
+    p.writeSize(tag);
+    p.writeSize(scratch.size());
+    p.write(scratch.data(), scratch.size());
+    if (out.size() >= threshold)
+      flush(dst);
+  }
+
+  /* Sends queued messages for dst (if any) */
+  void flush(int dst) {
+    Buffer<char> &out = outgoing[dst];
+    if (out.empty())
+      return;
+    releaseCompletedBatches();
+    in_flight.emplace_back();
+    InFlightBatch &batch = in_flight.back();
+    batch.bytes.swap(out);
+    batch.request = detail::isendRaw(batch.bytes.data(), batch.bytes.size(),
+                                     MPI_BYTE, dst, wire_tag, comm);
+  }
+
+  void flush() {
+    for (size_t dst = 0; dst < outgoing.size(); ++dst)
+      flush(dst);
+  }
+
+  /* Waits until all flushed batches are delivered to MPI */
+  void wait() { in_flight.clear(); }
+
+  /* Receives next logical message from src with tag (both could be
+   * wildcards) and unpacks it into obj */
+  template <class T>
+  Status recv(T &obj, int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG) {
+    Status res;
+    if (popPending(obj, src, tag, res))
+      return res;
+    flush();
+    do {
+      Message msg = mprobe(src, wire_tag, comm);
+      receiveBatch(msg);
+    } while (!popPending(obj, src, tag, res));
+    return res;
+  }
+
+  /* Like recv(), but returns false instead of blocking if there is no
+   * matching message yet. Doesn't flush */
+  template <class T>
+  bool tryRecv(T &obj, int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+               MPI_Status *status = MPI_STATUS_IGNORE) {
+    Status res;
+    while (!popPending(obj, src, tag, res)) {
+      Message msg = improbe(src, wire_tag, comm);
+      if (!msg)
+        return false;
+      receiveBatch(msg);
+    }
+    if (status != MPI_STATUS_IGNORE)
+      *status = res.getRaw();
+    return true;
+  }
+
+private:
+  struct InFlightBatch {
+    Buffer<char> bytes;
+    Request request;
+  };
+
+  struct PendingMessage {
+    int source;
+    int tag;
+    Buffer<char> bytes;
+  };
+
+  /* internal duplicate of the user's communicator */
+  MPI_Comm comm;
+  size_t threshold;
+  int wire_tag;
+  std::vector<Buffer<char>> outgoing;
+  /* Request destructor waits, so batch memory is freed only after
+   * send is completed */
+  std::deque<InFlightBatch> in_flight;
+  std::deque<PendingMessage> pending;
+  Buffer<char> scratch;
+
+  void releaseCompletedBatches() {
+    while (!in_flight.empty() && in_flight.front().request.test())
+      in_flight.pop_front();
+  }
+
+  void receiveBatch(Message &msg) {
+    int source = msg.status().source();
+    Buffer<char> batch;
+    detail::mrecvIntoExpandableContainer<detail::PackedTypeSelector>(msg,
+                                                                     batch);
+    Unpacker u{batch};
+    while (u.remaining()) {
+      PendingMessage m;
+      m.source = source;
+      m.tag = u.readSize();
+      size_t sz = u.readSize();
+      assert(sz <= u.remaining() && "Truncated batch");
+      m.bytes.resize(sz);
+      u.read(m.bytes.data(), sz);
+      pending.push_back(std::move(m));
+    }
+  }
+
+  template <class T>
+  bool popPending(T &obj, int src, int tag, Status &status) {
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+      if ((src != MPI_ANY_SOURCE && it->source != src) ||
+          (tag != MPI_ANY_TAG && it->tag != tag))
+        continue;
+      unpack(it->bytes, obj);
+      MPI_Status raw = MPI_Status();
+      raw.MPI_SOURCE = it->source;
+      raw.MPI_TAG = it->tag;
+      raw.MPI_ERROR = MPI_SUCCESS;
+      status = raw;
+      pending.erase(it);
+      return true;
+    }
+    return false;
+  }
+};
+
+} // namespace cxxmpi
@@ -0,0 +1,304 @@
+#pragma once
+
+#include "../Shared/GridView.hpp"
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace cxxmpi {
+
+/* Move-only owner of MPI_Request
+ *
+ * Destructor waits for the pending operation to complete, so a discarded
+ * Request turns isend()/irecv() into a blocking call rather than into a
+ * dangling operation. Buffers passed to isend()/irecv() must outlive the
+ * Request.
+ *
+ * Request has exactly the same layout as MPI_Request, so arrays of
+ * Requests are passed to MPI_Waitall() and friends without copying
+ */
+class Request {
+public:
+  Request() : handle(MPI_REQUEST_NULL) {}
+  explicit Request(MPI_Request r) : handle(r) {}
+
+  Request(const Request &other) = delete;
+  Request &operator=(const Request &other) = delete;
+
+  Request(Request &&other) : handle(other.release()) {}
+  Request &operator=(Request &&other) {
+    if (this != &other) {
+      wait();
+      handle = other.release();
+    }
+    return *this;
+  }
+
+  ~Request() { wait(); }
+
+  bool isNull() const { return handle == MPI_REQUEST_NULL; }
+
+  /* Blocks until completion. Does nothing for null request */
+  Status wait() {
+    MPI_Status res = MPI_Status();
+    if (!isNull())
+      detail::exitOnError(MPI_Wait(&handle, &res));
+    return res;
+  }
+
+  /* Returns true if operation has completed (or request is null) */
+  bool test(MPI_Status *status = MPI_STATUS_IGNORE) {
+    if (isNull())
+      return true;
+    int flag;
+    detail::exitOnError(MPI_Test(&handle, &flag, status));
+    return flag;
+  }
+
+  /* Request still has to be completed with wait() or test() */
+  void cancel() {
+    if (!isNull())
+      detail::exitOnError(MPI_Cancel(&handle));
+  }
+
+  MPI_Request getHandle() const { return handle; }
+
+  /* Gives up the ownership, caller is responsible for completion */
+  MPI_Request release() {
+    MPI_Request res = handle;
+    handle = MPI_REQUEST_NULL;
+    return res;
+  }
+
+private:
+  MPI_Request handle;
+};
+
+static_assert(sizeof(Request) == sizeof(MPI_Request),
+              "Request must be layout-compatible with MPI_Request");
+
+namespace detail {
+
+inline MPI_Request *getRawRequests(MutableArrayRef<Request> requests) {
+  return reinterpret_cast<MPI_Request *>(requests.data());
+}
+
+} // namespace detail
+
+/* Waits for all requests. Completed requests become null
+ * statuses (if specified) must have room for requests.size() elements */
+inline void waitAll(MutableArrayRef<Request> requests,
+                    MPI_Status *statuses = MPI_STATUSES_IGNORE) {
+  detail::exitOnError(MPI_Waitall(requests.size(),
+                                  detail::getRawRequests(requests), statuses));
+}
+
+/* Waits for any of requests and returns its index
+ * If all requests are null, MPI_UNDEFINED is returned */
+inline int waitAny(MutableArrayRef<Request> requests,
+                   MPI_Status *status = MPI_STATUS_IGNORE) {
+  int idx;
+  detail::exitOnError(MPI_Waitany(
+      requests.size(), detail::getRawRequests(requests), &idx, status));
+  return idx;
+}
+
+/* Returns indices of requests completed so far (possibly none). Doesn't
+ * block. statuses (if specified) must have room for requests.size() elements
+ */
+inline std::vector<int> testSome(MutableArrayRef<Request> requests,
+                                 MPI_Status *statuses = MPI_STATUSES_IGNORE) {
+  std::vector<int> indices(requests.size());
+  int count;
+  detail::exitOnError(MPI_Testsome(requests.size(),
+                                   detail::getRawRequests(requests), &count,
+                                   indices.data(), statuses));
+  /* all requests are null */
+  if (count == MPI_UNDEFINED)
+    count = 0;
+  indices.resize(count);
+  return indices;
+}
+
+namespace detail {
+
+inline Request isendRaw(const void *data, size_t count, MPI_Datatype type,
+                        int dst, int tag, const Comm &comm) {
+  LargeCount lc{count, type};
+  MPI_Request res;
+  exitOnError(MPI_Isend(data, lc.count(), lc.type(), dst, tag, comm, &res));
+  return Request{res};
+}
+
+inline Request irecvRaw(void *data, size_t count, MPI_Datatype type, int src,
+                        int tag, const Comm &comm) {
+  LargeCount lc{count, type};
+  MPI_Request res;
+  exitOnError(MPI_Irecv(data, lc.count(), lc.type(), src, tag, comm, &res));
+  return Request{res};
+}
+
+} // namespace detail
+
+/* Nonblocking send of scalar
+ * See send() for the description of ScalarT and TypeSelector */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request isend(const ScalarT &data, int dst, int tag = 0,
+              const Comm &comm = MPI_COMM_WORLD) {
+  return detail::isendRaw(&data, 1, TypeSelector::getHandle(), dst, tag, comm);
+}
+
+/* Temporaries would be destroyed while the send is in progress */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request isend(const ScalarT &&data, int dst, int tag = 0,
+              const Comm &comm = MPI_COMM_WORLD) = delete;
+
+/* Nonblocking send of std::vector */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+Request isend(const std::vector<ScalarT, Allocator> &data, int dst,
+              int tag = 0, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::isendRaw(data.data(), data.size(), TypeSelector::getHandle(),
+                          dst, tag, comm);
+}
+
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+Request isend(const std::vector<ScalarT, Allocator> &&data, int dst,
+              int tag = 0, const Comm &comm = MPI_COMM_WORLD) = delete;
+
+/* Nonblocking send of std::array */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          size_t N>
+Request isend(const std::array<ScalarT, N> &data, int dst, int tag = 0,
+              const Comm &comm = MPI_COMM_WORLD) {
+  return detail::isendRaw(data.data(), N, TypeSelector::getHandle(), dst, tag,
+                          comm);
+}
+
+/* Nonblocking send of C-array */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          size_t N>
+Request isend(const ScalarT (&data)[N], int dst, int tag = 0,
+              const Comm &comm = MPI_COMM_WORLD) {
+  return detail::isendRaw(data, N, TypeSelector::getHandle(), dst, tag, comm);
+}
+
+/* Nonblocking send of std::basic_string */
+template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
+          class Traits, class Allocator>
+Request isend(const std::basic_string<CharT, Traits, Allocator> &s, int dst,
+              int tag = 0, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::isendRaw(s.data(), s.size(), TypeSelector::getHandle(), dst,
+                          tag, comm);
+}
+
+template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
+          class Traits, class Allocator>
+Request isend(const std::basic_string<CharT, Traits, Allocator> &&s, int dst,
+              int tag = 0, const Comm &comm = MPI_COMM_WORLD) = delete;
+
+/* Nonblocking send of any contiguous range */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request isend(ArrayRef<ScalarT> data, int dst, int tag = 0,
+              const Comm &comm = MPI_COMM_WORLD) {
+  return detail::isendRaw(data.data(), data.size(), TypeSelector::getHandle(),
+                          dst, tag, comm);
+}
+
+/* Without this overload MutableArrayRef would be sent as a scalar */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request isend(MutableArrayRef<ScalarT> data, int dst, int tag = 0,
+              const Comm &comm = MPI_COMM_WORLD) {
+  return isend<ScalarT, TypeSelector>(ArrayRef<ScalarT>(data), dst, tag, comm);
+}
+
+/* Nonblocking send of single data element with user-specified data type */
+inline Request isend(const void *data, Datatype type, int dst, int tag = 0,
+                     const Comm &comm = MPI_COMM_WORLD) {
+  return detail::isendRaw(data, 1, type.getHandle(), dst, tag, comm);
+}
+
+/* Nonblocking send of 2D block of a grid, without packing */
+template <class T, class TypeSelector =
+                       DatatypeSelector<typename GridView<T>::value_type>>
+Request isend(GridView<T> data, int dst, int tag = 0,
+              const Comm &comm = MPI_COMM_WORLD) {
+  return isend(data.data(), data.template getType<TypeSelector>(), dst, tag,
+               comm);
+}
+
+/* Nonblocking receive of scalar */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request irecv(ScalarT &data, int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+              const Comm &comm = MPI_COMM_WORLD) {
+  return detail::irecvRaw(&data, 1, TypeSelector::getHandle(), src, tag, comm);
+}
+
+/* Nonblocking receive of std::vector
+ * Unlike blocking recv(), message length can't be probed in advance, so
+ * data is NOT extended: vector must already have enough room for the message.
+ * Actual number of received elements is available via Status */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+Request irecv(std::vector<ScalarT, Allocator> &data, int src = MPI_ANY_SOURCE,
+              int tag = MPI_ANY_TAG, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::irecvRaw(data.data(), data.size(), TypeSelector::getHandle(),
+                          src, tag, comm);
+}
+
+/* Nonblocking receive of std::array */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          size_t N>
+Request irecv(std::array<ScalarT, N> &data, int src = MPI_ANY_SOURCE,
+              int tag = MPI_ANY_TAG, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::irecvRaw(data.data(), N, TypeSelector::getHandle(), src, tag,
+                          comm);
+}
+
+/* Nonblocking receive of C-array */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          size_t N>
+Request irecv(ScalarT (&data)[N], int src = MPI_ANY_SOURCE,
+              int tag = MPI_ANY_TAG, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::irecvRaw(data, N, TypeSelector::getHandle(), src, tag, comm);
+}
+
+/* Nonblocking receive of std::basic_string
+ * The same as for std::vector, string must be already resized */
+template <class CharT, class TypeSelector = DatatypeSelector<CharT>,
+          class Traits, class Allocator>
+Request irecv(std::basic_string<CharT, Traits, Allocator> &s,
+              int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+              const Comm &comm = MPI_COMM_WORLD) {
+  return detail::irecvRaw(&s[0], s.size(), TypeSelector::getHandle(), src, tag,
+                          comm);
+}
+
+/* Nonblocking receive into any contiguous range */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+Request irecv(MutableArrayRef<ScalarT> data, int src = MPI_ANY_SOURCE,
+              int tag = MPI_ANY_TAG, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::irecvRaw(data.data(), data.size(), TypeSelector::getHandle(),
+                          src, tag, comm);
+}
+
+/* Nonblocking receive of single element with user-specified data type */
+inline Request irecv(void *data, Datatype type, int src = MPI_ANY_SOURCE,
+                     int tag = MPI_ANY_TAG, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::irecvRaw(data, 1, type.getHandle(), src, tag, comm);
+}
+
+/* Nonblocking receive into 2D block of a grid */
+template <class T, class TypeSelector = DatatypeSelector<T>>
+Request irecv(GridView<T> data, int src = MPI_ANY_SOURCE,
+              int tag = MPI_ANY_TAG, const Comm &comm = MPI_COMM_WORLD) {
+  return irecv(data.data(), data.template getType<TypeSelector>(), src, tag,
+               comm);
+}
+
+} // namespace cxxmpi
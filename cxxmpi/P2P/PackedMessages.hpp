@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../Shared/Serialization.hpp"
+#include "../Shared/misc.hpp"
+#include "../Support/DefaultInitAllocator.hpp"
+#include "BlockingMessages.hpp"
+
+namespace cxxmpi {
+namespace detail {
+
+struct PackedTypeSelector {
+  static MPI_Datatype getHandle() { return MPI_BYTE; }
+};
+
+} // namespace detail
+
+/* Send any serializable object (see Shared/Serialization.hpp) as a single
+ * message. Must be received with recvPacked() or mrecvPacked()
+ *
+ * Example:
+ * std::vector<std::vector<int>> Adjacency = ...;
+ * cxxmpi::sendPacked(Adjacency, 0);
+ * ...
+ * cxxmpi::recvPacked(Adjacency, 1);
+ */
+template <class T>
+void sendPacked(const T &obj, int dst, int tag = 0,
+                const Comm &comm = MPI_COMM_WORLD) {
+  Buffer<char> bytes = pack(obj);
+  detail::sendRaw(bytes.data(), bytes.size(), MPI_BYTE, dst, tag, comm);
+}
+
+/* Receive message matched by mprobe()/improbe() and unpack it into obj */
+template <class T> Status mrecvPacked(Message &msg, T &obj) {
+  Buffer<char> bytes;
+  auto status =
+      detail::mrecvIntoExpandableContainer<detail::PackedTypeSelector>(msg,
+                                                                       bytes);
+  unpack(bytes, obj);
+  return status;
+}
+
+/* Receive message sent with sendPacked(). Size of the message is probed,
+ * so obj may be of any size */
+template <class T>
+Status recvPacked(T &obj, int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+                  const Comm &comm = MPI_COMM_WORLD) {
+  Message msg = mprobe(src, tag, comm);
+  return mrecvPacked(msg, obj);
+}
+
+} // namespace cxxmpi
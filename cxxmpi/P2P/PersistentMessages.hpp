@@ -0,0 +1,259 @@
+#pragma once
+
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+
+#include <array>
+#include <cassert>
+#include <vector>
+
+namespace cxxmpi {
+
+/* Move-only owner of persistent request created by sendInit()/recvInit()
+ *
+ * Unlike Request, persistent request is not consumed by completion,
+ * start() + wait() may be repeated as many times as needed with no
+ * datatype lookup and matching setup on each iteration. Buffer is bound
+ * at creation time, so it must stay at the same address while the
+ * request is alive.
+ *
+ * Destructor waits for the active operation (if any) and frees the request
+ */
+class PersistentRequest {
+public:
+  PersistentRequest() : handle(MPI_REQUEST_NULL) {}
+  explicit PersistentRequest(MPI_Request r) : handle(r) {}
+
+  PersistentRequest(const PersistentRequest &other) = delete;
+  PersistentRequest &operator=(const PersistentRequest &other) = delete;
+
+  PersistentRequest(PersistentRequest &&other) : handle(other.handle) {
+    other.handle = MPI_REQUEST_NULL;
+  }
+  PersistentRequest &operator=(PersistentRequest &&other) {
+    if (this != &other) {
+      reset();
+      handle = other.handle;
+      other.handle = MPI_REQUEST_NULL;
+    }
+    return *this;
+  }
+
+  ~PersistentRequest() { reset(); }
+
+  bool isNull() const { return handle == MPI_REQUEST_NULL; }
+
+  void start() {
+    assert(!isNull() && "Trying to start null request");
+    detail::exitOnError(MPI_Start(&handle));
+  }
+
+  /* Blocks until completion. Returns immediately for inactive request */
+  Status wait() {
+    MPI_Status res = MPI_Status();
+    if (!isNull())
+      detail::exitOnError(MPI_Wait(&handle, &res));
+    return res;
+  }
+
+  /* Returns true if operation has completed (or request is inactive) */
+  bool test(MPI_Status *status = MPI_STATUS_IGNORE) {
+    if (isNull())
+      return true;
+    int flag;
+    detail::exitOnError(MPI_Test(&handle, &flag, status));
+    return flag;
+  }
+
+  MPI_Request getHandle() const { return handle; }
+
+private:
+  MPI_Request handle;
+
+  void reset() {
+    if (isNull())
+      return;
+    wait();
+    detail::exitOnError(MPI_Request_free(&handle));
+  }
+};
+
+static_assert(sizeof(PersistentRequest) == sizeof(MPI_Request),
+              "PersistentRequest must be layout-compatible with MPI_Request");
+
+namespace detail {
+
+inline MPI_Request *
+getRawRequests(MutableArrayRef<PersistentRequest> requests) {
+  return reinterpret_cast<MPI_Request *>(requests.data());
+}
+
+inline PersistentRequest sendInitRaw(const void *data, size_t count,
+                                     MPI_Datatype type, int dst, int tag,
+                                     const Comm &comm) {
+  LargeCount lc{count, type};
+  MPI_Request res;
+  exitOnError(
+      MPI_Send_init(data, lc.count(), lc.type(), dst, tag, comm, &res));
+  return PersistentRequest{res};
+}
+
+inline PersistentRequest recvInitRaw(void *data, size_t count,
+                                     MPI_Datatype type, int src, int tag,
+                                     const Comm &comm) {
+  LargeCount lc{count, type};
+  MPI_Request res;
+  exitOnError(
+      MPI_Recv_init(data, lc.count(), lc.type(), src, tag, comm, &res));
+  return PersistentRequest{res};
+}
+
+} // namespace detail
+
+/* Starts all requests with a single MPI_Startall() */
+inline void startAll(MutableArrayRef<PersistentRequest> requests) {
+  detail::exitOnError(
+      MPI_Startall(requests.size(), detail::getRawRequests(requests)));
+}
+
+/* Waits for all requests. Requests stay valid and may be started again */
+inline void waitAll(MutableArrayRef<PersistentRequest> requests,
+                    MPI_Status *statuses = MPI_STATUSES_IGNORE) {
+  detail::exitOnError(MPI_Waitall(requests.size(),
+                                  detail::getRawRequests(requests), statuses));
+}
+
+/* Persistent send of scalar */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+PersistentRequest sendInit(const ScalarT &data, int dst, int tag = 0,
+                           const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendInitRaw(&data, 1, TypeSelector::getHandle(), dst, tag,
+                             comm);
+}
+
+/* Persistent send of std::vector
+ * Vector must not be resized while request is alive */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+PersistentRequest sendInit(const std::vector<ScalarT, Allocator> &data,
+                           int dst, int tag = 0,
+                           const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendInitRaw(data.data(), data.size(),
+                             TypeSelector::getHandle(), dst, tag, comm);
+}
+
+/* Persistent send of std::array */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          size_t N>
+PersistentRequest sendInit(const std::array<ScalarT, N> &data, int dst,
+                           int tag = 0, const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendInitRaw(data.data(), N, TypeSelector::getHandle(), dst,
+                             tag, comm);
+}
+
+/* Persistent send of any contiguous range */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+PersistentRequest sendInit(ArrayRef<ScalarT> data, int dst, int tag = 0,
+                           const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendInitRaw(data.data(), data.size(),
+                             TypeSelector::getHandle(), dst, tag, comm);
+}
+
+/* Without this overload MutableArrayRef would be sent as a scalar */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+PersistentRequest sendInit(MutableArrayRef<ScalarT> data, int dst,
+                           int tag = 0, const Comm &comm = MPI_COMM_WORLD) {
+  return sendInit<ScalarT, TypeSelector>(ArrayRef<ScalarT>(data), dst, tag,
+                                         comm);
+}
+
+/* Persistent send of single element with user-specified data type */
+inline PersistentRequest sendInit(const void *data, Datatype type, int dst,
+                                  int tag = 0,
+                                  const Comm &comm = MPI_COMM_WORLD) {
+  return detail::sendInitRaw(data, 1, type.getHandle(), dst, tag, comm);
+}
+
+/* Persistent receive of scalar */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+PersistentRequest recvInit(ScalarT &data, int src = MPI_ANY_SOURCE,
+                           int tag = MPI_ANY_TAG,
+                           const Comm &comm = MPI_COMM_WORLD) {
+  return detail::recvInitRaw(&data, 1, TypeSelector::getHandle(), src, tag,
+                             comm);
+}
+
+/* Persistent receive of std::vector
+ * Message is received into existing elements, vector is never extended */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          class Allocator>
+PersistentRequest recvInit(std::vector<ScalarT, Allocator> &data,
+                           int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+                           const Comm &comm = MPI_COMM_WORLD) {
+  return detail::recvInitRaw(data.data(), data.size(),
+                             TypeSelector::getHandle(), src, tag, comm);
+}
+
+/* Persistent receive of std::array */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>,
+          size_t N>
+PersistentRequest recvInit(std::array<ScalarT, N> &data,
+                           int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+                           const Comm &comm = MPI_COMM_WORLD) {
+  return detail::recvInitRaw(data.data(), N, TypeSelector::getHandle(), src,
+                             tag, comm);
+}
+
+/* Persistent receive into any contiguous range */
+template <class ScalarT, class TypeSelector = DatatypeSelector<ScalarT>>
+PersistentRequest recvInit(MutableArrayRef<ScalarT> data,
+                           int src = MPI_ANY_SOURCE, int tag = MPI_ANY_TAG,
+                           const Comm &comm = MPI_COMM_WORLD) {
+  return detail::recvInitRaw(data.data(), data.size(),
+                             TypeSelector::getHandle(), src, tag, comm);
+}
+
+/* Persistent receive of single element with user-specified data type */
+inline PersistentRequest recvInit(void *data, Datatype type,
+                                  int src = MPI_ANY_SOURCE,
+                                  int tag = MPI_ANY_TAG,
+                                  const Comm &comm = MPI_COMM_WORLD) {
+  return detail::recvInitRaw(data, 1, type.getHandle(), src, tag, comm);
+}
+
+/* A set of persistent requests which are always started and completed
+ * together, for example halo exchange with all neighbors
+ *
+ * Example:
+ * cxxmpi::PersistentRequestGroup Exchange;
+ * Exchange.add(cxxmpi::recvInit(LowerGhost, Lower));
+ * Exchange.add(cxxmpi::recvInit(UpperGhost, Upper));
+ * Exchange.add(cxxmpi::sendInit(LowerBorder, Lower));
+ * Exchange.add(cxxmpi::sendInit(UpperBorder, Upper));
+ * for (...) {
+ *   Exchange.start();
+ *   ... // compute interior
+ *   Exchange.wait();
+ *   ... // compute borders
+ * }
+ */
+class PersistentRequestGroup {
+public:
+  void add(PersistentRequest r) { requests.push_back(std::move(r)); }
+
+  void start() { startAll(requests); }
+  void wait() { waitAll(requests); }
+  void run() {
+    start();
+    wait();
+  }
+
+  size_t size() const { return requests.size(); }
+  bool empty() const { return requests.empty(); }
+
+private:
+  std::vector<PersistentRequest> requests;
+};
+
+} // namespace cxxmpi
@@ -0,0 +1,178 @@
+/* Node-shared memory
+ *
+ * Processes on the same node may access each other's memory directly,
+ * without any MPI calls. SharedWindow allocates local part of each
+ * process in memory shared by the node (MPI_Win_allocate_shared) and gives
+ * plain pointers to parts of other processes on the node. So reading halo
+ * of a neighbor becomes a plain load, and the same memory may be used by
+ * threads of hybrid MPI + threads programs.
+ *
+ * Window is created over any communicator, which is split into nodes
+ * internally. Processes are identified by ranks in that communicator,
+ * remote() is empty for processes on other nodes, exchange data with
+ * them as usual.
+ *
+ * Access is not synchronized: call sync() after writing local part and
+ * before neighbors read it, and once more after reading before the local
+ * part is overwritten again.
+ *
+ * Example (1D stencil, neighbors are on the same node):
+ * auto Win = cxxmpi::SharedWindow<double>::allocate(Width * Height);
+ * while (...) {
+ *   computeStep(Win.local());
+ *   Win.sync();
+ *   if (Rank > 0) {
+ *     auto Upper = Win.remote(Rank - 1); // last row is Upper's lower border
+ *     ...
+ *   }
+ *   Win.sync();
+ * }
+ */
+
+#pragma once
+
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+#include "Window.hpp"
+
+#include <mpi.h>
+
+#include <cassert>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace cxxmpi {
+
+template <class T, class TypeSelector = DatatypeSelector<T>>
+class SharedWindow {
+public:
+  SharedWindow() = default;
+
+  /* Collective over comm. Allocates size elements for the calling process.
+   * Parts are contiguous over the node unless noncontig is set, which
+   * lets MPI place each part in memory close to its process (NUMA) */
+  static SharedWindow allocate(size_t size,
+                               const Comm &comm = MPI_COMM_WORLD,
+                               bool noncontig = false) {
+    SharedWindow res;
+    res.node_comm = comm.splitType();
+
+    MPI_Info info = MPI_INFO_NULL;
+    if (noncontig) {
+      detail::exitOnError(MPI_Info_create(&info));
+      detail::exitOnError(
+          MPI_Info_set(info, "alloc_shared_noncontig", "true"));
+    }
+    T *base;
+    MPI_Win handle;
+    detail::exitOnError(MPI_Win_allocate_shared(size * sizeof(T), sizeof(T),
+                                                info, res.node_comm, &base,
+                                                &handle));
+    if (noncontig)
+      detail::exitOnError(MPI_Info_free(&info));
+    res.win = Window<T, TypeSelector>::adopt(handle, base, size);
+    /* window stays in passive epoch for its whole life, sync() does the
+     * rest */
+    detail::exitOnError(MPI_Win_lock_all(MPI_MODE_NOCHECK, handle));
+
+    res.queryParts(comm);
+    return res;
+  }
+
+  SharedWindow(SharedWindow &&other) = default;
+
+  SharedWindow &operator=(SharedWindow &&other) {
+    SharedWindow tmp{std::move(other)};
+    std::swap(node_comm, tmp.node_comm);
+    std::swap(win, tmp.win);
+    std::swap(node_rank_of, tmp.node_rank_of);
+    std::swap(parts, tmp.parts);
+    return *this;
+  }
+
+  ~SharedWindow() {
+    int is_finalized;
+    MPI_Finalized(&is_finalized);
+    if (!win.isNull() && !is_finalized)
+      MPI_Win_unlock_all(win);
+  }
+
+  /* Underlying window, RMA operations are allowed on it as well */
+  const Window<T, TypeSelector> &getWindow() const { return win; }
+  const Comm &getNodeComm() const { return node_comm; }
+
+  MutableArrayRef<T> local() const { return win.local(); }
+
+  /* True if process with rank (in communicator the window was created
+   * over) is on this node */
+  bool isOnNode(int rank) const {
+    assertRank(rank);
+    return node_rank_of[rank] >= 0;
+  }
+
+  /* Part of process with rank, empty if it's not on this node */
+  MutableArrayRef<T> remote(int rank) const {
+    assertRank(rank);
+    int node_rank = node_rank_of[rank];
+    return node_rank >= 0 ? parts[node_rank] : MutableArrayRef<T>();
+  }
+
+  /* Makes writes of all processes on the node visible to all of them */
+  void sync() const {
+    detail::exitOnError(MPI_Win_sync(win));
+    detail::exitOnError(MPI_Barrier(node_comm));
+    detail::exitOnError(MPI_Win_sync(win));
+  }
+
+private:
+  /* declared first to be destroyed after the window */
+  Comm node_comm{MPI_COMM_NULL};
+  Window<T, TypeSelector> win;
+  /* rank in node_comm of each process of the original communicator, -1 if
+   * it's on other node */
+  std::vector<int> node_rank_of;
+  std::vector<MutableArrayRef<T>> parts;
+
+  void assertRank(int rank) const {
+    (void)rank;
+    assert(rank >= 0 && static_cast<size_t>(rank) < node_rank_of.size() &&
+           "Invalid rank");
+  }
+
+  void queryParts(const Comm &comm) {
+    /* MPI_Win_shared_query() may report sizes rounded up to pages, so
+     * exact ones are gathered */
+    int node_size = node_comm.size();
+    unsigned long long local_size = win.size();
+    std::vector<unsigned long long> sizes(node_size);
+    detail::exitOnError(MPI_Allgather(&local_size, 1, MPI_UNSIGNED_LONG_LONG,
+                                      sizes.data(), 1,
+                                      MPI_UNSIGNED_LONG_LONG, node_comm));
+    for (int i = 0; i < node_size; ++i) {
+      MPI_Aint size_bytes;
+      int disp_unit;
+      T *base;
+      detail::exitOnError(
+          MPI_Win_shared_query(win, i, &size_bytes, &disp_unit, &base));
+      parts.emplace_back(base, sizes[i]);
+    }
+
+    MPI_Group node_group, group;
+    detail::exitOnError(MPI_Comm_group(node_comm, &node_group));
+    detail::exitOnError(MPI_Comm_group(comm, &group));
+    std::vector<int> node_ranks(node_size), ranks(node_size);
+    std::iota(node_ranks.begin(), node_ranks.end(), 0);
+    detail::exitOnError(MPI_Group_translate_ranks(
+        node_group, node_size, node_ranks.data(), group, ranks.data()));
+    detail::exitOnError(MPI_Group_free(&group));
+    detail::exitOnError(MPI_Group_free(&node_group));
+
+    node_rank_of.assign(comm.size(), -1);
+    for (int i = 0; i < node_size; ++i)
+      node_rank_of[ranks[i]] = i;
+  }
+};
+
+} // namespace cxxmpi
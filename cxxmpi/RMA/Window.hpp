@@ -0,0 +1,293 @@
+/* One-sided communication (RMA)
+ *
+ * Window<T> exposes an array of T on each process of communicator. Other
+ * processes put() data into it, get() data from it and accumulate() into
+ * it without participation of the owner, so there is no message matching
+ * and no need to post receives for fixed exchange patterns. Offsets
+ * (disp) are in elements of T.
+ *
+ * RMA operations are only allowed inside epochs, which are RAII scopes
+ * here:
+ * - FenceEpoch: collective over the window, the simplest one, suits BSP
+ *   style steps where everyone communicates
+ * - AccessEpoch + ExposureEpoch (post/start/complete/wait): only the
+ *   processes which communicate synchronize, e.g. stencil neighbors
+ * - LockEpoch, LockAllEpoch (passive target): target doesn't take part at
+ *   all, e.g. shared counters
+ * All operations are complete when epoch ends (or on flush() in passive
+ * epochs), buffers must not be reused before that.
+ *
+ * Example (halo rows land directly in ghost rows of neighbors):
+ * // Local has a ghost row above and below Height rows of the grid
+ * auto Win = cxxmpi::Window<double>::create(Local);
+ * cxxmpi::FenceEpoch Epoch{Win};
+ * Win.put(FirstRow, Upper, (Height + 1) * Width); // lower ghost of upper
+ * Win.put(LastRow, Lower, 0);                     // upper ghost of lower
+ *
+ * Example (dynamic scheduling with shared counter on rank 0):
+ * auto Counter = cxxmpi::Window<long>::allocate(Rank == 0 ? 1 : 0);
+ * ...
+ * long Next;
+ * {
+ *   cxxmpi::LockEpoch Lock{Counter, 0};
+ *   Next = Counter.fetchAndOp(1L, 0, 0);
+ * }
+ */
+
+#pragma once
+
+#include "../Collective/Reduction.hpp"
+#include "../Shared/misc.hpp"
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+
+#include <mpi.h>
+
+#include <cassert>
+#include <functional>
+#include <utility>
+
+namespace cxxmpi {
+
+/* Move-only owner of MPI_Win over array of T. Construction and destruction
+ * are collective over the communicator */
+template <class T, class TypeSelector = DatatypeSelector<T>> class Window {
+public:
+  Window() = default;
+
+  /* Window over existing memory, which must outlive the window */
+  static Window create(MutableArrayRef<T> memory,
+                       const Comm &comm = MPI_COMM_WORLD) {
+    Window res;
+    detail::exitOnError(MPI_Win_create(
+        memory.data(), memory.size() * sizeof(T), sizeof(T), MPI_INFO_NULL,
+        comm, &res.handle));
+    res.base = memory.data();
+    res.local_size = memory.size();
+    return res;
+  }
+
+  /* Window over memory of size elements allocated by MPI, which may be
+   * faster for RMA (e.g. registered for RDMA). Memory is not initialized,
+   * so initialize it before the first epoch */
+  static Window allocate(size_t size, const Comm &comm = MPI_COMM_WORLD) {
+    Window res;
+    detail::exitOnError(MPI_Win_allocate(size * sizeof(T), sizeof(T),
+                                         MPI_INFO_NULL, comm, &res.base,
+                                         &res.handle));
+    res.local_size = size;
+    return res;
+  }
+
+  /* Takes ownership of handle, local part of which is size elements at
+   * base. It's freed in destructor */
+  static Window adopt(MPI_Win handle, T *base, size_t size) {
+    Window res;
+    res.handle = handle;
+    res.base = base;
+    res.local_size = size;
+    return res;
+  }
+
+  Window(const Window &other) = delete;
+  Window &operator=(const Window &other) = delete;
+
+  Window(Window &&other)
+      : handle(other.handle), base(other.base),
+        local_size(other.local_size) {
+    other.handle = MPI_WIN_NULL;
+    other.base = nullptr;
+    other.local_size = 0;
+  }
+
+  Window &operator=(Window &&other) {
+    Window tmp{std::move(other)};
+    std::swap(handle, tmp.handle);
+    std::swap(base, tmp.base);
+    std::swap(local_size, tmp.local_size);
+    return *this;
+  }
+
+  ~Window() {
+    int is_finalized;
+    MPI_Finalized(&is_finalized);
+    if (handle != MPI_WIN_NULL && !is_finalized)
+      MPI_Win_free(&handle);
+  }
+
+  MPI_Win getHandle() const { return handle; }
+  operator MPI_Win() const { return handle; }
+  bool isNull() const { return handle == MPI_WIN_NULL; }
+
+  /* Local part of the window. Access it only outside of epochs in which
+   * others may access it (or after fence/flush) */
+  T *data() const { return base; }
+  size_t size() const { return local_size; }
+  MutableArrayRef<T> local() const {
+    return MutableArrayRef<T>(base, local_size);
+  }
+
+  /* Write data to target's window starting at element disp */
+  void put(ArrayRef<T> data, int target, size_t disp) const {
+    detail::LargeCount lc{data.size(), TypeSelector::getHandle()};
+    detail::exitOnError(MPI_Put(data.data(), lc.count(), lc.type(), target,
+                                disp, lc.count(), lc.type(), handle));
+  }
+
+  /* Read result.size() elements of target's window starting at disp */
+  void get(MutableArrayRef<T> result, int target, size_t disp) const {
+    detail::LargeCount lc{result.size(), TypeSelector::getHandle()};
+    detail::exitOnError(MPI_Get(result.data(), lc.count(), lc.type(), target,
+                                disp, lc.count(), lc.type(), handle));
+  }
+
+  /* Elementwise window[disp + i] = op(data[i], window[disp + i]),
+   * atomic per element. Op must map to predefined MPI operation (see
+   * OpSelector), user-defined operations are not allowed in RMA */
+  template <class Op = std::plus<T>>
+  void accumulate(ArrayRef<T> data, int target, size_t disp,
+                  Op op = Op{}) const {
+    static_assert(detail::IsPredefinedOp<Op, T>::value,
+                  "RMA requires operation mapped to predefined MPI_Op");
+    detail::LargeCount lc{data.size(), TypeSelector::getHandle()};
+    detail::exitOnError(MPI_Accumulate(data.data(), lc.count(), lc.type(),
+                                       target, disp, lc.count(), lc.type(),
+                                       detail::getOp<T>(op), handle));
+  }
+
+  /* Atomically applies op to a single element, result gets its previous
+   * value once epoch ends or target is flushed (as with i* functions) */
+  template <class Op = std::plus<T>>
+  void ifetchAndOp(const T &value, T &result, int target, size_t disp,
+                   Op op = Op{}) const {
+    static_assert(detail::IsPredefinedOp<Op, T>::value,
+                  "RMA requires operation mapped to predefined MPI_Op");
+    detail::exitOnError(MPI_Fetch_and_op(&value, &result,
+                                         TypeSelector::getHandle(), target,
+                                         disp, detail::getOp<T>(op), handle));
+  }
+
+  /* Blocking version: flushes target, so it's only valid in passive
+   * target epochs (LockEpoch, LockAllEpoch) */
+  template <class Op = std::plus<T>>
+  T fetchAndOp(const T &value, int target, size_t disp, Op op = Op{}) const {
+    static_assert(detail::IsPredefinedOp<Op, T>::value,
+                  "RMA requires operation mapped to predefined MPI_Op");
+    T result;
+    ifetchAndOp(value, result, target, disp, op);
+    flush(target);
+    return result;
+  }
+
+  /* Atomically replaces element with value if it's equal to compare.
+   * result gets the previous value */
+  void compareAndSwap(const T &value, const T &compare, T &result,
+                      int target, size_t disp) const {
+    detail::exitOnError(MPI_Compare_and_swap(&value, &compare, &result,
+                                             TypeSelector::getHandle(),
+                                             target, disp, handle));
+  }
+
+  /* Collective synchronization, ends current fence epoch and starts the
+   * next one. Cheaper than FenceEpoch in a loop, which fences twice */
+  void fence(int assert_flags = 0) const {
+    detail::exitOnError(MPI_Win_fence(assert_flags, handle));
+  }
+
+  /* Complete operations to target (or all targets) in passive epoch */
+  void flush(int target) const {
+    detail::exitOnError(MPI_Win_flush(target, handle));
+  }
+  void flushAll() const { detail::exitOnError(MPI_Win_flush_all(handle)); }
+
+private:
+  MPI_Win handle = MPI_WIN_NULL;
+  T *base = nullptr;
+  size_t local_size = 0;
+};
+
+namespace detail {
+
+/* Subgroup of window's group, for PSCW epochs */
+inline MPI_Group getWindowGroup(MPI_Win win, ArrayRef<int> ranks) {
+  MPI_Group win_group, res;
+  exitOnError(MPI_Win_get_group(win, &win_group));
+  exitOnError(MPI_Group_incl(win_group, ranks.size(), ranks.data(), &res));
+  exitOnError(MPI_Group_free(&win_group));
+  return res;
+}
+
+} // namespace detail
+
+/* Fence at both ends, collective over the window */
+class FenceEpoch : public detail::NonCopyableAndMovable {
+public:
+  explicit FenceEpoch(MPI_Win win, int assert_flags = 0) : win(win) {
+    detail::exitOnError(MPI_Win_fence(assert_flags, win));
+  }
+  ~FenceEpoch() { detail::exitOnError(MPI_Win_fence(0, win)); }
+
+private:
+  MPI_Win win;
+};
+
+/* Access epoch (MPI_Win_start/complete): RMA operations to targets are
+ * allowed. Each target must open ExposureEpoch for this process */
+class AccessEpoch : public detail::NonCopyableAndMovable {
+public:
+  AccessEpoch(MPI_Win win, ArrayRef<int> targets) : win(win) {
+    MPI_Group group = detail::getWindowGroup(win, targets);
+    detail::exitOnError(MPI_Win_start(group, 0, win));
+    detail::exitOnError(MPI_Group_free(&group));
+  }
+  ~AccessEpoch() { detail::exitOnError(MPI_Win_complete(win)); }
+
+private:
+  MPI_Win win;
+};
+
+/* Exposure epoch (MPI_Win_post/wait): origins may access local window.
+ * Destructor waits until all of them complete their access epochs */
+class ExposureEpoch : public detail::NonCopyableAndMovable {
+public:
+  ExposureEpoch(MPI_Win win, ArrayRef<int> origins) : win(win) {
+    MPI_Group group = detail::getWindowGroup(win, origins);
+    detail::exitOnError(MPI_Win_post(group, 0, win));
+    detail::exitOnError(MPI_Group_free(&group));
+  }
+  ~ExposureEpoch() { detail::exitOnError(MPI_Win_wait(win)); }
+
+private:
+  MPI_Win win;
+};
+
+/* Passive target epoch on a single target. Shared lock lets several
+ * origins access target concurrently (use accumulate() for atomicity) */
+class LockEpoch : public detail::NonCopyableAndMovable {
+public:
+  LockEpoch(MPI_Win win, int target, bool exclusive = false)
+      : win(win), target(target) {
+    int lock_type = exclusive ? MPI_LOCK_EXCLUSIVE : MPI_LOCK_SHARED;
+    detail::exitOnError(MPI_Win_lock(lock_type, target, 0, win));
+  }
+  ~LockEpoch() { detail::exitOnError(MPI_Win_unlock(target, win)); }
+
+private:
+  MPI_Win win;
+  int target;
+};
+
+/* Shared lock on all processes of the window, usually held for a long
+ * time with Window::flush() completing operations */
+class LockAllEpoch : public detail::NonCopyableAndMovable {
+public:
+  explicit LockAllEpoch(MPI_Win win) : win(win) {
+    detail::exitOnError(MPI_Win_lock_all(0, win));
+  }
+  ~LockAllEpoch() { detail::exitOnError(MPI_Win_unlock_all(win)); }
+
+private:
+  MPI_Win win;
+};
+
+} // namespace cxxmpi
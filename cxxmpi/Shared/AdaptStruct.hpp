@@ -0,0 +1,141 @@
+/* CXXMPI_ADAPT_STRUCT() makes user-defined structs usable with all cxxmpi
+ * functions, i.e. it provides DatatypeSelector specialization
+ *
+ * Example:
+ * struct Particle {
+ *   double Pos[3];
+ *   float Mass;
+ *   int Id;
+ * };
+ * CXXMPI_ADAPT_STRUCT(Particle, Pos, Mass, Id)
+ * ...
+ * std::vector<Particle> Particles = ...;
+ * cxxmpi::send(Particles, 1); // single message, no per-call type creation
+ *
+ * - The macro must be used in the global namespace
+ * - Struct must be standard-layout (it's required by offsetof)
+ * - Field can be of any type for which DatatypeSelector is defined
+ *   (including other adapted structs) or a C-array of such type
+ * - Fields which are not listed are not transmitted
+ * - Up to 16 fields are supported
+ *
+ * MPI datatype is created and committed once per process, on the first use
+ * (which must happen after MPI_Init), and freed by cxxmpi::finalize(). Its
+ * extent equals sizeof(Type), so arrays of structs are transmitted in one
+ * message
+ */
+
+#pragma once
+
+#include "../Support/Utilities.hpp"
+#include "Datatype.hpp"
+#include "DatatypeRegistry.hpp"
+#include "DatatypeSelector.hpp"
+
+#include <mpi.h>
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace cxxmpi {
+namespace detail {
+
+template <class StructT> class StructTypeBuilder {
+public:
+  template <class FieldT> StructTypeBuilder &addField(size_t offset) {
+    using ElemT = typename std::remove_all_extents<FieldT>::type;
+    blocklengths.push_back(sizeof(FieldT) / sizeof(ElemT));
+    displacements.push_back(offset);
+    types.push_back(DatatypeSelector<ElemT>::getHandle());
+    return *this;
+  }
+
+  /* Returns uncommitted type */
+  Datatype build() const {
+    MPI_Datatype tmp, res;
+    exitOnError(MPI_Type_create_struct(blocklengths.size(),
+                                       blocklengths.data(),
+                                       displacements.data(), types.data(),
+                                       &tmp));
+    /* trailing padding must be taken into account in arrays */
+    exitOnError(MPI_Type_create_resized(tmp, 0, sizeof(StructT), &res));
+    exitOnError(MPI_Type_free(&tmp));
+    return Datatype{res};
+  }
+
+private:
+  std::vector<int> blocklengths;
+  std::vector<MPI_Aint> displacements;
+  std::vector<MPI_Datatype> types;
+};
+
+} // namespace detail
+} // namespace cxxmpi
+
+#define CXXMPI_DETAIL_CONCAT_IMPL(A, B) A##B
+#define CXXMPI_DETAIL_CONCAT(A, B) CXXMPI_DETAIL_CONCAT_IMPL(A, B)
+
+#define CXXMPI_DETAIL_NARGS_IMPL(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, \
+                                 _12, _13, _14, _15, _16, N, ...)              \
+  N
+#define CXXMPI_DETAIL_NARGS(...)                                               \
+  CXXMPI_DETAIL_NARGS_IMPL(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7,   \
+                           6, 5, 4, 3, 2, 1)
+
+#define CXXMPI_DETAIL_FOR_EACH_1(M, T, X) M(T, X)
+#define CXXMPI_DETAIL_FOR_EACH_2(M, T, X, ...)                                 \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_1(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_3(M, T, X, ...)                                 \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_2(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_4(M, T, X, ...)                                 \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_3(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_5(M, T, X, ...)                                 \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_4(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_6(M, T, X, ...)                                 \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_5(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_7(M, T, X, ...)                                 \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_6(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_8(M, T, X, ...)                                 \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_7(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_9(M, T, X, ...)                                 \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_8(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_10(M, T, X, ...)                                \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_9(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_11(M, T, X, ...)                                \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_10(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_12(M, T, X, ...)                                \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_11(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_13(M, T, X, ...)                                \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_12(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_14(M, T, X, ...)                                \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_13(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_15(M, T, X, ...)                                \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_14(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH_16(M, T, X, ...)                                \
+  M(T, X) CXXMPI_DETAIL_FOR_EACH_15(M, T, __VA_ARGS__)
+#define CXXMPI_DETAIL_FOR_EACH(M, T, ...)                                      \
+  CXXMPI_DETAIL_CONCAT(CXXMPI_DETAIL_FOR_EACH_,                                \
+                       CXXMPI_DETAIL_NARGS(__VA_ARGS__))(M, T, __VA_ARGS__)
+
+#define CXXMPI_DETAIL_ADD_FIELD(Type, Field)                                   \
+  .addField<decltype(Type::Field)>(offsetof(Type, Field))
+
+#define CXXMPI_ADAPT_STRUCT(Type, ...)                                         \
+  static_assert(std::is_standard_layout<Type>::value,                          \
+                "CXXMPI_ADAPT_STRUCT requires standard-layout type");          \
+  namespace cxxmpi {                                                           \
+  template <> struct DatatypeSelector<Type, void> {                            \
+    static MPI_Datatype getHandle() {                                          \
+      static const MPI_Datatype handle =                                       \
+          detail::DatatypeRegistry::get()                                      \
+              .keep(OwnedDatatype{detail::StructTypeBuilder<Type>()            \
+                                      CXXMPI_DETAIL_FOR_EACH(                  \
+                                          CXXMPI_DETAIL_ADD_FIELD, Type,       \
+                                          __VA_ARGS__)                         \
+                                          .build()})                           \
+              .getHandle();                                                    \
+      return handle;                                                           \
+    }                                                                          \
+  };                                                                           \
+  }
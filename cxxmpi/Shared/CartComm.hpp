@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+#include "Comm.hpp"
+
+#include <cassert>
+#include <vector>
+
+namespace cxxmpi {
+
+/* Result of CartComm::shift(). At non-periodic boundaries the missing
+ * neighbor is MPI_PROC_NULL, so communication with it is a no-op */
+struct CartShift {
+  int source;
+  int dest;
+};
+
+/* Communicator with Cartesian topology
+ *
+ * Zero dimensions are chosen by MPI_Dims_create(). By default MPI may
+ * reorder ranks to map neighbors onto nearby hardware, so rank in CartComm
+ * may differ from rank in the original communicator: distribute data by
+ * CartComm ranks (or pass reorder = false if layout is tied to the old
+ * ranks).
+ *
+ * Neighbors of process are ordered as in MPI neighborhood collectives (see
+ * Collective/NeighborCollectives.hpp): for each dimension the one at -1,
+ * then the one at +1.
+ *
+ * Example:
+ * auto Grid = cxxmpi::CartComm::grid(2, true); // periodic 2D grid
+ * auto Rows = Grid.shift(0);
+ * cxxmpi::sendrecv(Top, Rows.dest, Halo, Rows.source, 0, Grid);
+ */
+class CartComm : public Comm {
+public:
+  /* Collective over comm. Processes which don't fit into the grid (if
+   * product of dims is less than comm size) get null communicator */
+  CartComm(std::vector<int> dims, const std::vector<bool> &periodic,
+           const Comm &comm = MPI_COMM_WORLD, bool reorder = true)
+      : Comm(createHandle(dims, periodic, comm, reorder)),
+        dims(std::move(dims)), periodic(periodic) {}
+
+  /* ndims-dimensional grid of all processes with sizes chosen by MPI */
+  static CartComm grid(int ndims, bool periodic,
+                       const Comm &comm = MPI_COMM_WORLD,
+                       bool reorder = true) {
+    return CartComm{std::vector<int>(ndims, 0),
+                    std::vector<bool>(ndims, periodic), comm, reorder};
+  }
+
+  int getNumDims() const { return dims.size(); }
+  ArrayRef<int> getDims() const { return dims; }
+  bool isPeriodic(int dim) const { return periodic[dim]; }
+
+  /* Number of neighbors in neighborhood collectives */
+  int getNumNeighbors() const { return 2 * getNumDims(); }
+
+  std::vector<int> getCoords(int rank) const {
+    std::vector<int> res(dims.size());
+    detail::exitOnError(MPI_Cart_coords(*this, rank, res.size(), res.data()));
+    return res;
+  }
+  std::vector<int> getCoords() const { return getCoords(rank()); }
+
+  /* Coordinates out of range are wrapped along periodic dimensions */
+  int getRank(ArrayRef<int> coords) const {
+    assert(coords.size() == dims.size() && "invalid number of coordinates");
+    int res;
+    detail::exitOnError(MPI_Cart_rank(*this, coords.data(), &res));
+    return res;
+  }
+
+  /* Neighbors at distance disp along dimension dim: dest is the one to
+   * send to, source is the one to receive from */
+  CartShift shift(int dim, int disp = 1) const {
+    assert(dim >= 0 && dim < getNumDims() && "invalid dimension");
+    CartShift res;
+    detail::exitOnError(
+        MPI_Cart_shift(*this, dim, disp, &res.source, &res.dest));
+    return res;
+  }
+
+private:
+  std::vector<int> dims;
+  std::vector<bool> periodic;
+
+  /* Fills zeros in dims */
+  static Comm createHandle(std::vector<int> &dims,
+                           const std::vector<bool> &periodic,
+                           const Comm &comm, bool reorder) {
+    assert(dims.size() == periodic.size() &&
+           "periodicity must be specified for each dimension");
+    detail::exitOnError(
+        MPI_Dims_create(comm.size(), dims.size(), dims.data()));
+    std::vector<int> periods(periodic.begin(), periodic.end());
+    MPI_Comm res;
+    detail::exitOnError(MPI_Cart_create(comm, dims.size(), dims.data(),
+                                        periods.data(), reorder, &res));
+    return Comm::adopt(res);
+  }
+};
+
+} // namespace cxxmpi
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "../Support/Utilities.hpp"
+
+#include <cassert>
+#include <initializer_list>
+#include <mpi.h>
+#include <utility>
+
+namespace cxxmpi {
+namespace detail {
+
+/* Rank and size in MPI_COMM_WORLD never change, so they are queried once */
+struct WorldInfo {
+  int rank;
+  int size;
+
+  WorldInfo() {
+    exitOnError(MPI_Comm_rank(MPI_COMM_WORLD, &rank));
+    exitOnError(MPI_Comm_size(MPI_COMM_WORLD, &size));
+  }
+
+  static const WorldInfo &get() {
+    static WorldInfo info;
+    return info;
+  }
+};
+
+} // namespace detail
+
+/* Communicator with cached rank and size
+ *
+ * Comm either wraps existing MPI_Comm (implicit conversion, doesn't free
+ * it) or owns communicator created by dup(), split() or splitType() and
+ * frees it in destructor. All cxxmpi functions take const Comm &, so both
+ * MPI_Comm and Comm may be passed. Temporary Comm created from MPI_Comm
+ * queries rank lazily, so to avoid repeated MPI_Comm_rank() calls in hot
+ * loops keep Comm object and pass it instead. Rank and size of
+ * MPI_COMM_WORLD are cached for the whole program, so the default argument
+ * is free.
+ *
+ * Comm converts back to MPI_Comm, so it can be passed to plain MPI too.
+ *
+ * Example:
+ * cxxmpi::Comm Row = cxxmpi::Comm{}.split(Rank / Width);
+ * cxxmpi::Comm Node = cxxmpi::Comm{}.splitType();
+ * for (...)
+ *   cxxmpi::allreduceInPlace(Data, std::plus<double>{}, Row);
+ */
+class Comm {
+public:
+  Comm(MPI_Comm handle = MPI_COMM_WORLD) : handle(handle) {
+    if (handle == MPI_COMM_WORLD) {
+      const detail::WorldInfo &info = detail::WorldInfo::get();
+      cached_rank = info.rank;
+      cached_size = info.size;
+    }
+  }
+
+  /* Takes ownership of handle, it's freed in destructor */
+  static Comm adopt(MPI_Comm handle) {
+    Comm res{handle};
+    res.owned = (handle != MPI_COMM_NULL);
+    return res;
+  }
+
+  Comm(const Comm &other) = delete;
+  Comm &operator=(const Comm &other) = delete;
+
+  Comm(Comm &&other)
+      : handle(other.handle), owned(other.owned),
+        cached_rank(other.cached_rank), cached_size(other.cached_size) {
+    other.handle = MPI_COMM_NULL;
+    other.owned = false;
+  }
+
+  Comm &operator=(Comm &&other) {
+    Comm tmp{std::move(other)};
+    std::swap(handle, tmp.handle);
+    std::swap(owned, tmp.owned);
+    std::swap(cached_rank, tmp.cached_rank);
+    std::swap(cached_size, tmp.cached_size);
+    return *this;
+  }
+
+  /* Non-owning Comm (e.g. temporary made for an argument) makes no MPI
+   * calls here */
+  ~Comm() {
+    if (!owned)
+      return;
+    int is_finalized;
+    MPI_Finalized(&is_finalized);
+    if (!is_finalized)
+      MPI_Comm_free(&handle);
+  }
+
+  int rank() const {
+    assert(!isNull() && "Trying to use null communicator");
+    if (cached_rank < 0)
+      detail::exitOnError(MPI_Comm_rank(handle, &cached_rank));
+    return cached_rank;
+  }
+
+  int size() const {
+    assert(!isNull() && "Trying to use null communicator");
+    if (cached_size < 0)
+      detail::exitOnError(MPI_Comm_size(handle, &cached_size));
+    return cached_size;
+  }
+
+  MPI_Comm get() const { return handle; }
+  operator MPI_Comm() const { return handle; }
+
+  /* split() with color = MPI_UNDEFINED returns null communicator */
+  bool isNull() const { return handle == MPI_COMM_NULL; }
+  bool isOwned() const { return owned; }
+
+  /* Collective, creates communicator with the same group */
+  Comm dup() const {
+    MPI_Comm res;
+    detail::exitOnError(MPI_Comm_dup(handle, &res));
+    return adopt(res);
+  }
+
+  /* Collective, processes with the same color get into one communicator
+   * ordered by key (by rank in this communicator by default) */
+  Comm split(int color, int key) const {
+    MPI_Comm res;
+    detail::exitOnError(MPI_Comm_split(handle, color, key, &res));
+    return adopt(res);
+  }
+  Comm split(int color) const { return split(color, rank()); }
+
+  /* Collective, by default splits processes into shared memory nodes */
+  Comm splitType(int type, int key) const {
+    MPI_Comm res;
+    detail::exitOnError(
+        MPI_Comm_split_type(handle, type, key, MPI_INFO_NULL, &res));
+    return adopt(res);
+  }
+  Comm splitType(int type = MPI_COMM_TYPE_SHARED) const {
+    return splitType(type, rank());
+  }
+
+private:
+  MPI_Comm handle;
+  bool owned = false;
+  /* -1 if not queried yet */
+  mutable int cached_rank = -1;
+  mutable int cached_size = -1;
+};
+
+namespace detail {
+
+/* Keyval of attribute holding internal duplicate, see getInternalComm() */
+inline int &internalCommKeyval() {
+  static int keyval = MPI_KEYVAL_INVALID;
+  return keyval;
+}
+
+inline int deleteInternalComm(MPI_Comm, int, void *attr, void *) {
+  MPI_Comm *internal = static_cast<MPI_Comm *>(attr);
+  int res = MPI_Comm_free(internal);
+  delete internal;
+  return res;
+}
+
+/* Duplicate of comm for point-to-point messages sent inside cxxmpi
+ * functions (e.g. large collectives), so that user's receives with
+ * MPI_ANY_TAG can't intercept them. Created on the first request for comm,
+ * which must be collective then, cached as attribute of comm and freed
+ * together with it */
+inline MPI_Comm getInternalComm(MPI_Comm comm) {
+  int &keyval = internalCommKeyval();
+  if (keyval == MPI_KEYVAL_INVALID)
+    exitOnError(MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN,
+                                       deleteInternalComm, &keyval, nullptr));
+  MPI_Comm *internal;
+  int found;
+  exitOnError(MPI_Comm_get_attr(comm, keyval, &internal, &found));
+  if (found)
+    return *internal;
+  internal = new MPI_Comm;
+  exitOnError(MPI_Comm_dup(comm, internal));
+  exitOnError(MPI_Comm_set_attr(comm, keyval, internal));
+  return *internal;
+}
+
+/* Predefined communicators are never freed, so their duplicates are freed
+ * explicitly before MPI_Finalize() */
+inline void freeInternalComms() {
+  int &keyval = internalCommKeyval();
+  if (keyval == MPI_KEYVAL_INVALID)
+    return;
+  for (MPI_Comm comm : {MPI_COMM_WORLD, MPI_COMM_SELF}) {
+    void *internal;
+    int found;
+    exitOnError(MPI_Comm_get_attr(comm, keyval, &internal, &found));
+    if (found)
+      exitOnError(MPI_Comm_delete_attr(comm, keyval));
+  }
+  exitOnError(MPI_Comm_free_keyval(&keyval));
+}
+
+} // namespace detail
+} // namespace cxxmpi
@@ -3,6 +3,7 @@
 #include "../Support/ArrayRef.hpp"
 #include "BuiltinTypeTraits.hpp"
 #include <cassert>
+#include <utility>
 
 namespace cxxmpi {
 
@@ -67,12 +68,58 @@ private:
   Datatype type;
 };
 
+/* Owns committed user-defined type and frees it in destructor (unless MPI
+ * is already finalized). Move-only. Prefer cached types from
+ * Shared/DatatypeRegistry.hpp if the same layout is used repeatedly */
+class OwnedDatatype {
+public:
+  OwnedDatatype() = default;
+  /* Takes ownership of uncommitted type t and commits it */
+  explicit OwnedDatatype(Datatype t) : type(t) { type.commit(); }
+
+  OwnedDatatype(const OwnedDatatype &other) = delete;
+  OwnedDatatype &operator=(const OwnedDatatype &other) = delete;
+
+  OwnedDatatype(OwnedDatatype &&other) : type(other.type) {
+    other.type = Datatype{};
+  }
+
+  OwnedDatatype &operator=(OwnedDatatype &&other) {
+    OwnedDatatype tmp{std::move(other)};
+    std::swap(type, tmp.type);
+    return *this;
+  }
+
+  ~OwnedDatatype() {
+    int is_finalized;
+    MPI_Finalized(&is_finalized);
+    if (!type.isNull() && !is_finalized)
+      type.free();
+  }
+
+  Datatype get() const { return type; }
+  MPI_Datatype getHandle() const { return type.getHandle(); }
+  bool isNull() const { return type.isNull(); }
+
+  /* Gives up ownership, caller is responsible for freeing the type */
+  Datatype release() {
+    Datatype res = type;
+    type = Datatype{};
+    return res;
+  }
+
+private:
+  Datatype type;
+};
+
 /* get builtin types: int, float, ... */
 template <class BuiltinT> Datatype getBuiltinType() {
   return BuiltinTypeTraits<BuiltinT>::getHandle();
 }
 
-Datatype createContiguousType(Datatype old_type, size_t count) {
+/* create*Type() functions make a new uncommitted type on each call. In
+ * loops use cached get*Type() from Shared/DatatypeRegistry.hpp instead */
+inline Datatype createContiguousType(Datatype old_type, size_t count) {
   MPI_Datatype new_type;
   detail::exitOnError(MPI_Type_contiguous(static_cast<int>(count),
                                           old_type.getHandle(), &new_type));
@@ -83,7 +130,7 @@ template <class BuiltinT> Datatype createContiguousType(size_t count) {
   return createContiguousType(getBuiltinType<BuiltinT>(), count);
 }
 
-Datatype createIndexedTypeH(Datatype old_type, ArrayRef<int> blocklengths,
+inline Datatype createIndexedTypeH(Datatype old_type, ArrayRef<int> blocklengths,
                             ArrayRef<MPI_Aint> displacements) {
   assert(blocklengths.size() == displacements.size() &&
          "blocklengths and displacements must have the same size");
@@ -94,4 +141,39 @@ Datatype createIndexedTypeH(Datatype old_type, ArrayRef<int> blocklengths,
   return Datatype{new_type};
 }
 
+/* count blocks of blocklength elements, starting stride elements apart,
+ * e.g. a column of row-major matrix is (rows, 1, cols) */
+inline Datatype createVectorType(Datatype old_type, size_t count,
+                                 size_t blocklength, size_t stride) {
+  MPI_Datatype new_type;
+  detail::exitOnError(MPI_Type_vector(
+      static_cast<int>(count), static_cast<int>(blocklength),
+      static_cast<int>(stride), old_type.getHandle(), &new_type));
+  return Datatype{new_type};
+}
+
+/* Block of subsizes elements at starts in row-major (C order) array of
+ * sizes. Extent of the type is the extent of the whole array */
+inline Datatype createSubarrayType(Datatype old_type, ArrayRef<int> sizes,
+                                   ArrayRef<int> subsizes,
+                                   ArrayRef<int> starts) {
+  assert(sizes.size() == subsizes.size() && sizes.size() == starts.size() &&
+         "sizes, subsizes and starts must have the same size");
+  MPI_Datatype new_type;
+  detail::exitOnError(MPI_Type_create_subarray(
+      sizes.size(), sizes.data(), subsizes.data(), starts.data(),
+      MPI_ORDER_C, old_type.getHandle(), &new_type));
+  return Datatype{new_type};
+}
+
+/* The same type with lower bound and extent (in bytes) changed, which
+ * defines where consecutive elements of this type start */
+inline Datatype createResizedType(Datatype old_type, MPI_Aint lb,
+                                  MPI_Aint extent) {
+  MPI_Datatype new_type;
+  detail::exitOnError(MPI_Type_create_resized(old_type.getHandle(), lb,
+                                              extent, &new_type));
+  return Datatype{new_type};
+}
+
 } // namespace cxxmpi
\ No newline at end of file
@@ -0,0 +1,165 @@
+/* Process-wide cache of derived datatypes
+ *
+ * Creating and committing MPI type is not free, so building the same layout
+ * in a loop either wastes time or leaks types. get*Type() functions look up
+ * the layout by its shape (kind of constructor, base type and parameters)
+ * and create and commit the type only on the first request. Returned handle
+ * is owned by registry: don't free it. All cached types are freed by
+ * cxxmpi::finalize() (and thus by MPIContext destructor).
+ *
+ * Base types are identified by handle, so a user-defined base type must
+ * outlive all types cached on top of it. Registry is not thread-safe,
+ * request types from one thread only.
+ *
+ * Example:
+ * for (...) {
+ *   // created once, committed, reused in the following iterations
+ *   auto Ty = cxxmpi::getIndexedTypeH(MPI_DOUBLE, Lengths, Displs);
+ *   MPI_Send(Buf, 1, Ty.getHandle(), Dest, 0, MPI_COMM_WORLD);
+ * }
+ */
+
+#pragma once
+
+#include "../Support/ArrayRef.hpp"
+#include "../Support/Utilities.hpp"
+#include "Datatype.hpp"
+
+#include <mpi.h>
+
+#include <cassert>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace cxxmpi {
+namespace detail {
+
+/* Identifies derived type: types with equal shapes are interchangeable */
+struct DatatypeShape {
+  enum Kind { Contiguous, IndexedH, Vector, Subarray, Resized };
+
+  Kind kind;
+  MPI_Datatype base;
+  /* constructor arguments, meaning depends on kind */
+  std::vector<MPI_Aint> params;
+
+  bool operator<(const DatatypeShape &other) const {
+    if (kind != other.kind)
+      return kind < other.kind;
+    if (base != other.base)
+      return std::less<MPI_Datatype>{}(base, other.base);
+    return params < other.params;
+  }
+};
+
+class DatatypeRegistry : public NonCopyableAndMovable {
+public:
+  static DatatypeRegistry &get() {
+    static DatatypeRegistry registry;
+    return registry;
+  }
+
+  /* create() returns uncommitted type, it's called only if shape is not in
+   * registry yet */
+  template <class Creator>
+  Datatype getOrCreate(const DatatypeShape &shape, Creator create) {
+    auto it = types.find(shape);
+    if (it == types.end())
+      it = types.emplace(shape, OwnedDatatype{create()}).first;
+    return it->second.get();
+  }
+
+  /* Takes type which is cached elsewhere (e.g. adapted struct types) to
+   * free it together with the registry */
+  Datatype keep(OwnedDatatype type) {
+    kept.push_back(std::move(type));
+    return kept.back().get();
+  }
+
+  size_t size() const { return types.size(); }
+
+  /* Frees all types, handles returned before become invalid */
+  void clear() {
+    types.clear();
+    kept.clear();
+  }
+
+private:
+  std::map<DatatypeShape, OwnedDatatype> types;
+  std::vector<OwnedDatatype> kept;
+
+  DatatypeRegistry() = default;
+};
+
+} // namespace detail
+
+/* Committed contiguous type of count elements of old_type, cached */
+inline Datatype getContiguousType(Datatype old_type, size_t count) {
+  detail::DatatypeShape shape{detail::DatatypeShape::Contiguous,
+                              old_type.getHandle(),
+                              {static_cast<MPI_Aint>(count)}};
+  return detail::DatatypeRegistry::get().getOrCreate(shape, [&] {
+    return createContiguousType(old_type, count);
+  });
+}
+
+template <class BuiltinT> Datatype getContiguousType(size_t count) {
+  return getContiguousType(getBuiltinType<BuiltinT>(), count);
+}
+
+/* Committed hindexed type, cached. Displacements are in bytes */
+inline Datatype getIndexedTypeH(Datatype old_type, ArrayRef<int> blocklengths,
+                                ArrayRef<MPI_Aint> displacements) {
+  assert(blocklengths.size() == displacements.size() &&
+         "blocklengths and displacements must have the same size");
+  detail::DatatypeShape shape{detail::DatatypeShape::IndexedH,
+                              old_type.getHandle(),
+                              {}};
+  shape.params.assign(blocklengths.begin(), blocklengths.end());
+  shape.params.insert(shape.params.end(), displacements.begin(),
+                      displacements.end());
+  return detail::DatatypeRegistry::get().getOrCreate(shape, [&] {
+    return createIndexedTypeH(old_type, blocklengths, displacements);
+  });
+}
+
+/* Committed vector type, cached. Parameters are as in createVectorType() */
+inline Datatype getVectorType(Datatype old_type, size_t count,
+                              size_t blocklength, size_t stride) {
+  detail::DatatypeShape shape{detail::DatatypeShape::Vector,
+                              old_type.getHandle(),
+                              {static_cast<MPI_Aint>(count),
+                               static_cast<MPI_Aint>(blocklength),
+                               static_cast<MPI_Aint>(stride)}};
+  return detail::DatatypeRegistry::get().getOrCreate(shape, [&] {
+    return createVectorType(old_type, count, blocklength, stride);
+  });
+}
+
+/* Committed C-order subarray type, cached */
+inline Datatype getSubarrayType(Datatype old_type, ArrayRef<int> sizes,
+                                ArrayRef<int> subsizes, ArrayRef<int> starts) {
+  detail::DatatypeShape shape{detail::DatatypeShape::Subarray,
+                              old_type.getHandle(),
+                              {}};
+  for (ArrayRef<int> arg : {sizes, subsizes, starts})
+    shape.params.insert(shape.params.end(), arg.begin(), arg.end());
+  return detail::DatatypeRegistry::get().getOrCreate(shape, [&] {
+    return createSubarrayType(old_type, sizes, subsizes, starts);
+  });
+}
+
+/* Committed resized type, cached */
+inline Datatype getResizedType(Datatype old_type, MPI_Aint lb,
+                               MPI_Aint extent) {
+  detail::DatatypeShape shape{detail::DatatypeShape::Resized,
+                              old_type.getHandle(),
+                              {lb, extent}};
+  return detail::DatatypeRegistry::get().getOrCreate(shape, [&] {
+    return createResizedType(old_type, lb, extent);
+  });
+}
+
+} // namespace cxxmpi
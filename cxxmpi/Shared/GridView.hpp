@@ -0,0 +1,123 @@
+/* View of 2D block of row-major grid
+ *
+ * GridView describes num_rows x num_cols elements whose rows start stride
+ * elements apart, e.g. the whole local grid, its border column or an
+ * interior sub-block. Views of parts are made by block(), row() and
+ * column() without copying. getType() gives committed datatype describing
+ * the view relative to data(), so any block is sent and received directly
+ * from grid storage, no pack/unpack copies needed. Types are cached (see
+ * Shared/DatatypeRegistry.hpp), so views may be recreated in a loop.
+ *
+ * send(), recv(), sendrecv(), isend() and irecv() accept views.
+ *
+ * Example (exchange of border columns in 2D decomposition):
+ * auto Grid = cxxmpi::makeGridView(Local, Width); // with 1 cell halo
+ * auto Cols = Cart.shift(1);
+ * cxxmpi::sendrecv(Grid.block(1, Width - 2, Height - 2, 1), Cols.dest,
+ *                  Grid.block(1, 0, Height - 2, 1), Cols.source, 0, Cart);
+ */
+
+#pragma once
+
+#include "../Support/Utilities.hpp"
+#include "Datatype.hpp"
+#include "DatatypeRegistry.hpp"
+#include "DatatypeSelector.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace cxxmpi {
+
+template <class T> class GridView {
+public:
+  using value_type = typename std::remove_const<T>::type;
+
+  GridView() = default;
+  GridView(T *data, size_t num_rows, size_t num_cols, size_t stride)
+      : ptr(data), num_rows(num_rows), num_cols(num_cols), stride(stride) {
+    assert((num_rows <= 1 || num_cols <= stride) &&
+           "rows of the view must not overlap");
+  }
+  GridView(T *data, size_t num_rows, size_t num_cols)
+      : GridView(data, num_rows, num_cols, num_cols) {}
+
+  /* Mutable view converts to const one */
+  template <class U, class = detail::enable_if_t<
+                         std::is_same<const U, T>::value>>
+  GridView(const GridView<U> &other)
+      : GridView(other.data(), other.getNumRows(), other.getNumCols(),
+                 other.getStride()) {}
+
+  T *data() const { return ptr; }
+  size_t getNumRows() const { return num_rows; }
+  size_t getNumCols() const { return num_cols; }
+  /* Distance between starts of consecutive rows in elements */
+  size_t getStride() const { return stride; }
+  size_t size() const { return num_rows * num_cols; }
+  bool empty() const { return size() == 0; }
+  bool isContiguous() const { return num_rows <= 1 || num_cols == stride; }
+
+  T &operator()(size_t i, size_t j) const {
+    assert(i < num_rows && j < num_cols && "Invalid index");
+    return ptr[i * stride + j];
+  }
+
+  /* num_rows x num_cols block with upper left corner at (row, col) */
+  GridView block(size_t row, size_t col, size_t num_rows,
+                 size_t num_cols) const {
+    assert(row + num_rows <= this->num_rows &&
+           col + num_cols <= this->num_cols && "Block is out of the view");
+    return GridView{ptr + row * stride + col, num_rows, num_cols, stride};
+  }
+  GridView row(size_t i) const { return block(i, 0, 1, num_cols); }
+  GridView column(size_t j) const { return block(0, j, num_rows, 1); }
+
+  /* Committed type of the whole view, starting at data() */
+  template <class TypeSelector = DatatypeSelector<value_type>>
+  Datatype getType() const {
+    Datatype elem = TypeSelector::getHandle();
+    if (isContiguous())
+      return getContiguousType(elem, size());
+    return getVectorType(elem, num_rows, num_cols, stride);
+  }
+
+  /* Committed type of a column of the view, resized to the extent of one
+   * element, so that count consecutive columns are count elements of this
+   * type. E.g. scatter of column blocks:
+   * MPI_Scatter(View.data(), Cols, View.getColumnType().getHandle(), ...) */
+  template <class TypeSelector = DatatypeSelector<value_type>>
+  Datatype getColumnType() const {
+    Datatype elem = TypeSelector::getHandle();
+    MPI_Aint lb, extent;
+    detail::exitOnError(MPI_Type_get_extent(elem.getHandle(), &lb, &extent));
+    return getResizedType(getVectorType(elem, num_rows, 1, stride), 0,
+                          extent);
+  }
+
+private:
+  T *ptr = nullptr;
+  size_t num_rows = 0;
+  size_t num_cols = 0;
+  size_t stride = 0;
+};
+
+/* View of the whole row-major grid stored in vector */
+template <class T, class Allocator>
+GridView<T> makeGridView(std::vector<T, Allocator> &data, size_t num_cols) {
+  assert(num_cols != 0 && data.size() % num_cols == 0 &&
+         "Data must consist of whole rows");
+  return GridView<T>{data.data(), data.size() / num_cols, num_cols};
+}
+
+template <class T, class Allocator>
+GridView<const T> makeGridView(const std::vector<T, Allocator> &data,
+                               size_t num_cols) {
+  assert(num_cols != 0 && data.size() % num_cols == 0 &&
+         "Data must consist of whole rows");
+  return GridView<const T>{data.data(), data.size() / num_cols, num_cols};
+}
+
+} // namespace cxxmpi
@@ -0,0 +1,128 @@
+/* Support for messages with more than INT_MAX elements
+ *
+ * MPI-3 functions take element counts as int. MPI-4 adds "_c" versions
+ * of every function which take MPI_Count, but they are not available
+ * everywhere, so P2P functions of cxxmpi use a derived type trick: a huge
+ * buffer is described by a single element of a derived type, which is
+ * created on the fly. It costs nothing for usual (small) messages.
+ * Collectives with per-process counts and displacements can't be handled
+ * this way, they use "_c" functions if CXXMPI_HAS_LARGE_COUNT is set and
+ * fall back to point-to-point messages otherwise. gatherv() is the
+ * exception: only root knows the total there, so the fallback is opt-in
+ * (gathervLarge())
+ */
+
+#pragma once
+
+#include "../Support/Utilities.hpp"
+
+#include <mpi.h>
+
+#include <cassert>
+#include <climits>
+#include <cstddef>
+
+#ifndef CXXMPI_HAS_LARGE_COUNT
+#if MPI_VERSION >= 4
+#define CXXMPI_HAS_LARGE_COUNT 1
+#else
+#define CXXMPI_HAS_LARGE_COUNT 0
+#endif
+#endif
+
+namespace cxxmpi {
+namespace detail {
+
+inline bool fitsInt(size_t count) {
+  return count <= static_cast<size_t>(INT_MAX);
+}
+
+/* Represents `count` elements of `base` as (count(), type()) pair which
+ * may be passed to any MPI function taking int count.
+ *
+ * If count fits into int, it is passed as is. Otherwise a derived type
+ * describing the whole buffer is created and count() == 1. Derived type is
+ * freed in destructor, which is safe even if nonblocking operation using it
+ * is still pending (MPI defers actual deallocation).
+ * Type signature is the same in both cases, so message sent with
+ * LargeCount can be received with plain count and vice versa
+ */
+class LargeCount : public NonCopyableAndMovable {
+public:
+  LargeCount(size_t count, MPI_Datatype base)
+      : elem_count(static_cast<int>(count)), elem_type(base),
+        is_derived(!fitsInt(count)) {
+    if (is_derived) {
+      elem_type = createLargeType(count, base);
+      elem_count = 1;
+    }
+  }
+
+  ~LargeCount() {
+    if (is_derived)
+      exitOnError(MPI_Type_free(&elem_type));
+  }
+
+  int count() const { return elem_count; }
+  MPI_Datatype type() const { return elem_type; }
+
+private:
+  int elem_count;
+  MPI_Datatype elem_type;
+  bool is_derived;
+
+  /* Layout: [blocks x chunk of base][remainder x base] */
+  static MPI_Datatype createLargeType(size_t count, MPI_Datatype base) {
+    const size_t chunk = size_t{1} << 30;
+    size_t blocks = count / chunk;
+    size_t remainder = count % chunk;
+    assert(fitsInt(blocks) && "message is way too large");
+
+    MPI_Aint lb, extent;
+    exitOnError(MPI_Type_get_extent(base, &lb, &extent));
+
+    MPI_Datatype chunk_type, body_type, tail_type, res;
+    exitOnError(MPI_Type_contiguous(chunk, base, &chunk_type));
+    exitOnError(MPI_Type_contiguous(blocks, chunk_type, &body_type));
+    exitOnError(MPI_Type_contiguous(remainder, base, &tail_type));
+
+    int blocklengths[2] = {1, 1};
+    MPI_Aint displacements[2] = {0, static_cast<MPI_Aint>(blocks * chunk) *
+                                        extent};
+    MPI_Datatype types[2] = {body_type, tail_type};
+    exitOnError(MPI_Type_create_struct(2, blocklengths, displacements, types,
+                                       &res));
+    exitOnError(MPI_Type_commit(&res));
+
+    exitOnError(MPI_Type_free(&tail_type));
+    exitOnError(MPI_Type_free(&body_type));
+    exitOnError(MPI_Type_free(&chunk_type));
+    return res;
+  }
+};
+
+/* Number of elements of type in received message, works even if count
+ * doesn't fit into int (MPI_Get_count() returns MPI_UNDEFINED then) */
+inline size_t getLargeCount(const MPI_Status &status, MPI_Datatype type) {
+#if CXXMPI_HAS_LARGE_COUNT
+  MPI_Count res;
+  exitOnError(MPI_Get_count_c(&status, type, &res));
+  return res;
+#else
+  int res;
+  exitOnError(MPI_Get_count(&status, type, &res));
+  if (res != MPI_UNDEFINED)
+    return res;
+  /* Status keeps the message length in bytes in all common implementations
+   * so this gives the count of a message of any size */
+  MPI_Count bytes, type_sz;
+  exitOnError(MPI_Get_elements_x(&status, MPI_BYTE, &bytes));
+  exitOnError(MPI_Type_size_x(type, &type_sz));
+  assert(type_sz > 0 && bytes % type_sz == 0 &&
+         "message length is not a multiple of type size");
+  return bytes / type_sz;
+#endif
+}
+
+} // namespace detail
+} // namespace cxxmpi
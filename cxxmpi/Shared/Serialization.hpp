@@ -0,0 +1,305 @@
+/* Serialization of objects which can't be described by a single MPI datatype:
+ * vectors of vectors, strings, maps, structs with dynamic members, etc.
+ *
+ * Object is flattened into one contiguous byte buffer, so it can be
+ * transmitted as a single message (see sendPacked() and recvPacked()).
+ * Layout is compact: trivially copyable data is copied as is and container
+ * sizes are stored as variable-length integers (1 byte for sizes < 128).
+ * Both sides must run on the same architecture, byte order is not converted.
+ *
+ * Supported out of the box:
+ * - Trivially copyable types (including adapted and plain structs)
+ * - std::vector, std::basic_string, std::array, std::pair, std::map
+ *   of supported types, with arbitrary nesting
+ * - Structs adapted with CXXMPI_SERIALIZABLE_STRUCT()
+ * - Anything else, for which Serializer is specialized
+ *
+ * Example:
+ * std::map<std::string, std::vector<int>> Index = ...;
+ * cxxmpi::Buffer<char> Bytes = cxxmpi::pack(Index);
+ * auto Copy = cxxmpi::unpack<decltype(Index)>(Bytes);
+ */
+
+#pragma once
+
+#include "../Support/ArrayRef.hpp"
+#include "../Support/DefaultInitAllocator.hpp"
+#include "../Support/Utilities.hpp"
+#include "AdaptStruct.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cxxmpi {
+
+/* Appends serialized data to the byte buffer */
+class Packer {
+public:
+  explicit Packer(Buffer<char> &output) : out(output) {}
+
+  void write(const void *data, size_t sz) {
+    if (sz == 0)
+      return;
+    size_t pos = out.size();
+    out.resize(pos + sz);
+    std::memcpy(out.data() + pos, data, sz);
+  }
+
+  /* LEB128-like encoding: 7 bits per byte, high bit means continuation */
+  void writeSize(size_t sz) {
+    char bytes[(sizeof(size_t) * 8 + 6) / 7];
+    size_t len = 0;
+    do {
+      unsigned char byte = sz & 0x7f;
+      sz >>= 7;
+      if (sz)
+        byte |= 0x80;
+      bytes[len++] = static_cast<char>(byte);
+    } while (sz);
+    write(bytes, len);
+  }
+
+private:
+  Buffer<char> &out;
+};
+
+/* Reads serialized data from the byte range */
+class Unpacker {
+public:
+  explicit Unpacker(ArrayRef<char> input)
+      : cur(input.data()), end(input.data() + input.size()) {}
+
+  void read(void *data, size_t sz) {
+    assert(sz <= remaining() && "Truncated serialized data");
+    if (sz == 0)
+      return;
+    std::memcpy(data, cur, sz);
+    cur += sz;
+  }
+
+  size_t readSize() {
+    size_t res = 0;
+    unsigned shift = 0;
+    unsigned char byte;
+    do {
+      assert(shift < sizeof(size_t) * 8 && "Malformed size in serialized data");
+      read(&byte, 1);
+      res |= static_cast<size_t>(byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    return res;
+  }
+
+  size_t remaining() const { return end - cur; }
+
+private:
+  const char *cur;
+  const char *end;
+};
+
+/* Users may specialize Serializer for their own types. Specialization must
+ * provide
+ *   static void pack(Packer &p, const T &obj);
+ *   static void unpack(Unpacker &u, T &obj);
+ * Second template argument is for SFINAE
+ */
+template <class T, class = void> struct Serializer;
+
+template <class T>
+struct Serializer<T,
+                  detail::enable_if_t<std::is_trivially_copyable<T>::value>> {
+  static void pack(Packer &p, const T &obj) { p.write(&obj, sizeof(T)); }
+  static void unpack(Unpacker &u, T &obj) { u.read(&obj, sizeof(T)); }
+};
+
+namespace detail {
+
+/* Elements of vector and string are copied with a single memcpy() when
+ * possible (vector<bool> has no data() at all) */
+template <class T>
+using IsBulkSerializable =
+    std::integral_constant<bool, std::is_trivially_copyable<T>::value &&
+                                     !std::is_same<T, bool>::value>;
+
+template <class Container>
+void packElements(Packer &p, const Container &data, std::true_type) {
+  using ValueT = typename Container::value_type;
+  p.write(data.data(), data.size() * sizeof(ValueT));
+}
+
+template <class Container>
+void packElements(Packer &p, const Container &data, std::false_type) {
+  using ValueT = typename Container::value_type;
+  for (const ValueT &elem : data)
+    Serializer<ValueT>::pack(p, elem);
+}
+
+template <class Container>
+void unpackElements(Unpacker &u, Container &data, size_t sz, std::true_type) {
+  using ValueT = typename Container::value_type;
+  assert(sz <= u.remaining() / sizeof(ValueT) && "Truncated serialized data");
+  data.resize(sz);
+  if (sz == 0)
+    return;
+  u.read(&data[0], sz * sizeof(ValueT));
+}
+
+template <class Container>
+void unpackElements(Unpacker &u, Container &data, size_t sz,
+                    std::false_type) {
+  using ValueT = typename Container::value_type;
+  data.clear();
+  /* each element takes at least one byte, so this doesn't overallocate
+   * much even for malformed input */
+  data.reserve(sz < u.remaining() ? sz : u.remaining());
+  for (size_t i = 0; i < sz; ++i) {
+    ValueT elem;
+    Serializer<ValueT>::unpack(u, elem);
+    data.push_back(std::move(elem));
+  }
+}
+
+} // namespace detail
+
+template <class T, class Allocator>
+struct Serializer<std::vector<T, Allocator>> {
+  static void pack(Packer &p, const std::vector<T, Allocator> &obj) {
+    p.writeSize(obj.size());
+    detail::packElements(p, obj, detail::IsBulkSerializable<T>{});
+  }
+  static void unpack(Unpacker &u, std::vector<T, Allocator> &obj) {
+    size_t sz = u.readSize();
+    detail::unpackElements(u, obj, sz, detail::IsBulkSerializable<T>{});
+  }
+};
+
+template <class CharT, class Traits, class Allocator>
+struct Serializer<std::basic_string<CharT, Traits, Allocator>> {
+  using StringT = std::basic_string<CharT, Traits, Allocator>;
+
+  static void pack(Packer &p, const StringT &obj) {
+    p.writeSize(obj.size());
+    detail::packElements(p, obj, std::true_type{});
+  }
+  static void unpack(Unpacker &u, StringT &obj) {
+    size_t sz = u.readSize();
+    detail::unpackElements(u, obj, sz, std::true_type{});
+  }
+};
+
+/* std::array and std::pair of trivially copyable types are trivially
+ * copyable themselves and handled above */
+template <class T, size_t N>
+struct Serializer<std::array<T, N>,
+                  detail::enable_if_t<
+                      !std::is_trivially_copyable<std::array<T, N>>::value>> {
+  static void pack(Packer &p, const std::array<T, N> &obj) {
+    for (const T &elem : obj)
+      Serializer<T>::pack(p, elem);
+  }
+  static void unpack(Unpacker &u, std::array<T, N> &obj) {
+    for (T &elem : obj)
+      Serializer<T>::unpack(u, elem);
+  }
+};
+
+template <class T1, class T2>
+struct Serializer<std::pair<T1, T2>,
+                  detail::enable_if_t<
+                      !std::is_trivially_copyable<std::pair<T1, T2>>::value>> {
+  static void pack(Packer &p, const std::pair<T1, T2> &obj) {
+    Serializer<T1>::pack(p, obj.first);
+    Serializer<T2>::pack(p, obj.second);
+  }
+  static void unpack(Unpacker &u, std::pair<T1, T2> &obj) {
+    Serializer<T1>::unpack(u, obj.first);
+    Serializer<T2>::unpack(u, obj.second);
+  }
+};
+
+template <class Key, class T, class Compare, class Allocator>
+struct Serializer<std::map<Key, T, Compare, Allocator>> {
+  using MapT = std::map<Key, T, Compare, Allocator>;
+
+  static void pack(Packer &p, const MapT &obj) {
+    p.writeSize(obj.size());
+    for (const auto &kv : obj) {
+      Serializer<Key>::pack(p, kv.first);
+      Serializer<T>::pack(p, kv.second);
+    }
+  }
+  static void unpack(Unpacker &u, MapT &obj) {
+    obj.clear();
+    size_t sz = u.readSize();
+    for (size_t i = 0; i < sz; ++i) {
+      Key key;
+      T value;
+      Serializer<Key>::unpack(u, key);
+      Serializer<T>::unpack(u, value);
+      /* keys are already sorted, so insertion is amortized O(1) */
+      obj.emplace_hint(obj.end(), std::move(key), std::move(value));
+    }
+  }
+};
+
+/* Appends serialized obj to the buffer */
+template <class T> void pack(const T &obj, Buffer<char> &output) {
+  Packer p{output};
+  Serializer<T>::pack(p, obj);
+}
+
+template <class T> Buffer<char> pack(const T &obj) {
+  Buffer<char> res;
+  pack(obj, res);
+  return res;
+}
+
+/* Restores obj from bytes, which must contain exactly one serialized object
+ */
+template <class T> void unpack(ArrayRef<char> bytes, T &obj) {
+  Unpacker u{bytes};
+  Serializer<T>::unpack(u, obj);
+  assert(u.remaining() == 0 && "Trailing bytes in serialized data");
+}
+
+template <class T> T unpack(ArrayRef<char> bytes) {
+  T res;
+  unpack(bytes, res);
+  return res;
+}
+
+} // namespace cxxmpi
+
+#define CXXMPI_DETAIL_PACK_FIELD(Type, Field)                                  \
+  ::cxxmpi::Serializer<decltype(Type::Field)>::pack(p, obj.Field);
+#define CXXMPI_DETAIL_UNPACK_FIELD(Type, Field)                                \
+  ::cxxmpi::Serializer<decltype(Type::Field)>::unpack(u, obj.Field);
+
+/* Makes struct with non-trivially copyable members serializable
+ * field by field. Must be used in the global namespace, up to 16 fields
+ *
+ * Example:
+ * struct Record {
+ *   std::string Name;
+ *   std::vector<double> Values;
+ * };
+ * CXXMPI_SERIALIZABLE_STRUCT(Record, Name, Values)
+ */
+#define CXXMPI_SERIALIZABLE_STRUCT(Type, ...)                                  \
+  namespace cxxmpi {                                                           \
+  template <> struct Serializer<Type, void> {                                  \
+    static void pack(Packer &p, const Type &obj) {                             \
+      CXXMPI_DETAIL_FOR_EACH(CXXMPI_DETAIL_PACK_FIELD, Type, __VA_ARGS__)      \
+    }                                                                          \
+    static void unpack(Unpacker &u, Type &obj) {                               \
+      CXXMPI_DETAIL_FOR_EACH(CXXMPI_DETAIL_UNPACK_FIELD, Type, __VA_ARGS__)    \
+    }                                                                          \
+  };                                                                           \
+  }
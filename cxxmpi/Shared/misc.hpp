@@ -3,56 +3,56 @@
 #pragma once
 
 #include "../Support/Utilities.hpp"
+#include "Comm.hpp"
 #include "Datatype.hpp"
+#include "DatatypeRegistry.hpp"
 #include "DatatypeSelector.hpp"
+#include "LargeCount.hpp"
 #include <iostream>
 
 namespace cxxmpi {
 
 /* These 2 are just for completeness, consider using MPIContext instead */
-void init(int *argc, char ***argv) {
+inline void init(int *argc, char ***argv) {
   detail::exitOnError(MPI_Init(argc, argv));
 }
-void finalize() { detail::exitOnError(MPI_Finalize()); }
+/* Frees cached types (see DatatypeRegistry) and internal communicators
+ * before finalizing */
+inline void finalize() {
+  detail::DatatypeRegistry::get().clear();
+  detail::freeInternalComms();
+  detail::exitOnError(MPI_Finalize());
+}
 
 struct MPIContext {
   MPIContext(int *argc, char ***argv) { init(argc, argv); }
   ~MPIContext() { finalize(); }
 };
 
-bool initialized() {
+inline bool initialized() {
   int res;
   detail::exitOnError(MPI_Initialized(&res));
   return res;
 }
 
-bool finalized() {
+inline bool finalized() {
   int res;
   detail::exitOnError(MPI_Finalized(&res));
   return res;
 }
 
-int commSize(MPI_Comm comm = MPI_COMM_WORLD) {
-  int res;
-  detail::exitOnError(MPI_Comm_size(comm, &res));
-  return res;
-}
-
-int commRank(MPI_Comm comm = MPI_COMM_WORLD) {
-  int res;
-  detail::exitOnError(MPI_Comm_rank(comm, &res));
-  return res;
-}
+/* Cached, see Comm */
+inline int commSize(const Comm &comm = MPI_COMM_WORLD) { return comm.size(); }
+inline int commRank(const Comm &comm = MPI_COMM_WORLD) { return comm.rank(); }
 
-double wtime() { return MPI_Wtime(); }
+inline double wtime() { return MPI_Wtime(); }
 
-double wtick() { return MPI_Wtick(); }
+inline double wtick() { return MPI_Wtick(); }
 
-/* Prefer using Status interface */
-int getCount(const MPI_Status &s, MPI_Datatype type) {
-  int res;
-  detail::exitOnError(MPI_Get_count(&s, type, &res));
-  return res;
+/* Prefer using Status interface
+ * Works for messages with more than INT_MAX elements as well */
+inline size_t getCount(const MPI_Status &s, MPI_Datatype type) {
+  return detail::getLargeCount(s, type);
 }
 
 /* Wrapper for MPI_Status */
@@ -107,11 +107,11 @@ private:
  * Example:
  * std::cout << whoami << ": Hello, world!" << std::endl;
  */
-std::ostream &whoami(std::ostream &Os) {
+inline std::ostream &whoami(std::ostream &Os) {
   return Os << '[' << commRank() + 1 << '/' << commSize() << "]";
 }
 
-MPI_Aint getAddress(const void *location) {
+inline MPI_Aint getAddress(const void *location) {
   MPI_Aint res;
   detail::exitOnError(MPI_Get_address(location, &res));
   return res;
@@ -214,7 +214,9 @@ public:
   MutableArrayRef(T *data, size_t length) : ArrayRef<T>(data, length) {}
 
   MutableArrayRef(T *begin, T *end) : ArrayRef<T>(begin, end) {}
-  MutableArrayRef(std::vector<T> &Vec) : ArrayRef<T>(Vec) {}
+
+  template <typename A>
+  MutableArrayRef(std::vector<T, A> &Vec) : ArrayRef<T>(Vec) {}
 
   template <size_t N>
   constexpr MutableArrayRef(std::array<T, N> &Arr) : ArrayRef<T>(Arr) {}
@@ -361,4 +363,9 @@ MutableArrayRef<T> makeMutableArrayRef(T *data, size_t length) {
   return MutableArrayRef<T>(data, length);
 }
 
+template <typename T, typename A>
+MutableArrayRef<T> makeMutableArrayRef(std::vector<T, A> &Vec) {
+  return Vec;
+}
+
 } // namespace cxxmpi
\ No newline at end of file
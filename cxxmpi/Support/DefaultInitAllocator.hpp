@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cxxmpi {
+
+/* Allocator adaptor which default-initializes elements instead of
+ * value-initializing them, i.e. resize() of std::vector<int,
+ * DefaultInitAllocator<int>> doesn't fill new elements with zeros.
+ *
+ * It is useful for receive buffers: memory is going to be overwritten by MPI
+ * anyway, so zero-filling it first is just a wasted pass over memory
+ */
+template <class T, class BaseAllocator = std::allocator<T>>
+class DefaultInitAllocator : public BaseAllocator {
+  using BaseTraits = std::allocator_traits<BaseAllocator>;
+
+public:
+  template <class U> struct rebind {
+    using other = DefaultInitAllocator<
+        U, typename BaseTraits::template rebind_alloc<U>>;
+  };
+
+  using BaseAllocator::BaseAllocator;
+
+  /* construct without arguments, i.e. resize() and vector(size_t) */
+  template <class U>
+  void construct(U *ptr) noexcept(
+      std::is_nothrow_default_constructible<U>::value) {
+    ::new (static_cast<void *>(ptr)) U;
+  }
+
+  template <class U, class... ArgsT> void construct(U *ptr, ArgsT &&...args) {
+    BaseTraits::construct(static_cast<BaseAllocator &>(*this), ptr,
+                          std::forward<ArgsT>(args)...);
+  }
+};
+
+/* std::vector which never value-initializes its elements. Since it is still
+ * std::vector, it may be passed to all cxxmpi functions accepting vectors.
+ * Results of recv(), gatherv(), scatterFair(), etc. are returned as Buffer
+ * if Buffer was passed in */
+template <class T> using Buffer = std::vector<T, DefaultInitAllocator<T>>;
+
+} // namespace cxxmpi
@@ -6,7 +6,7 @@
 namespace cxxmpi {
 namespace detail {
 
-void exitOnError(int RetCode) {
+inline void exitOnError(int RetCode) {
   if (RetCode)
     exit(EXIT_FAILURE);
 }
@@ -29,5 +29,9 @@ template <class...> using void_t = void;
 template <bool B, class T = void>
 using enable_if_t = typename std::enable_if<B, T>::type;
 
+/* Excludes argument from template argument deduction */
+template <class T> struct type_identity { using type = T; };
+template <class T> using type_identity_t = typename type_identity<T>::type;
+
 } // namespace detail
 } // namespace cxxmpi
\ No newline at end of file
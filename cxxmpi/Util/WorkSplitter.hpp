@@ -2,25 +2,28 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <vector>
 
 namespace util {
 
 /* Represents integer range [FirstIdx; LastIdx)
  * Note that LastIdx is not included into the range
+ * IndexT is int by default, use WorkRangeLinear64 for huge ranges
  */
-struct WorkRangeLinear {
-  int FirstIdx;
-  int LastIdx;
+template <class IndexT> struct BasicWorkRangeLinear {
+  IndexT FirstIdx;
+  IndexT LastIdx;
 
-  WorkRangeLinear(int First, int Last) : FirstIdx(First), LastIdx(Last) {
+  BasicWorkRangeLinear(IndexT First, IndexT Last)
+      : FirstIdx(First), LastIdx(Last) {
     assert(FirstIdx >= 0);
     assert(LastIdx >= 0);
   }
 
-  int size() const { return LastIdx - FirstIdx; }
-  WorkRangeLinear shift(int Offset) const {
-    return WorkRangeLinear{FirstIdx + Offset, LastIdx + Offset};
+  IndexT size() const { return LastIdx - FirstIdx; }
+  BasicWorkRangeLinear shift(IndexT Offset) const {
+    return BasicWorkRangeLinear{FirstIdx + Offset, LastIdx + Offset};
   }
 };
 
@@ -28,56 +31,62 @@ struct WorkRangeLinear {
  * Suppose we are splitting 11 work items to 4 workers
  * Then workers will have work ranges [0, 3), [3, 6), [6, 9), [9, 11),
  * i.e. work sizes are 3, 3, 3, 2
+ *
+ * All the math is done in IndexT, so use WorkSplitterLinear64 if amount of
+ * work (e.g. number of elements in a distributed array) may exceed INT_MAX
  */
-class WorkSplitterLinear {
+template <class IndexT> class BasicWorkSplitterLinear {
 public:
-  WorkSplitterLinear(int WorkSz, int NumWorkers)
+  using RangeT = BasicWorkRangeLinear<IndexT>;
+
+  BasicWorkSplitterLinear(IndexT WorkSz, int NumWorkers)
       : WorkSz(WorkSz), NumWorkers(NumWorkers) {
     assert(WorkSz >= 0 && "invalid WorkSz");
     assert(NumWorkers >= 1 && "invalid NumWorkers");
   }
 
-  WorkRangeLinear getRange(int WorkerId) const {
+  RangeT getRange(int WorkerId) const {
     assert(WorkerId >= 0 && "invalid WorkerId");
     assert(WorkerId < NumWorkers && "invalid WorkerId");
 
-    int DefaultGroupSz = WorkSz / NumWorkers;
+    IndexT DefaultGroupSz = WorkSz / NumWorkers;
 
     if (WorkerId < WorkSz % NumWorkers) {
-      int FirstIdx = WorkerId * (DefaultGroupSz + 1);
-      int LastIdx = FirstIdx + (DefaultGroupSz + 1);
-      return WorkRangeLinear{FirstIdx, LastIdx};
+      IndexT FirstIdx = WorkerId * (DefaultGroupSz + 1);
+      IndexT LastIdx = FirstIdx + (DefaultGroupSz + 1);
+      return RangeT{FirstIdx, LastIdx};
     }
 
-    int NumOfEnlargedGroups = WorkSz % NumWorkers;
-    int FirstIdx = NumOfEnlargedGroups * (DefaultGroupSz + 1) +
-                   (WorkerId - NumOfEnlargedGroups) * DefaultGroupSz;
-    int LastIdx = FirstIdx + DefaultGroupSz;
-    return WorkRangeLinear{FirstIdx, LastIdx};
+    IndexT NumOfEnlargedGroups = WorkSz % NumWorkers;
+    IndexT FirstIdx = NumOfEnlargedGroups * (DefaultGroupSz + 1) +
+                      (WorkerId - NumOfEnlargedGroups) * DefaultGroupSz;
+    IndexT LastIdx = FirstIdx + DefaultGroupSz;
+    return RangeT{FirstIdx, LastIdx};
   }
 
-  template <class T = int> std::vector<T> getSizes() const {
+  template <class T = IndexT> std::vector<T> getSizes() const {
     std::vector<T> Sizes(NumWorkers); // {} must not be used here!
-    int DefaultGroupSz = WorkSz / NumWorkers;
+    IndexT DefaultGroupSz = WorkSz / NumWorkers;
     int NonDefaultWorkers = WorkSz % NumWorkers;
-    std::fill_n(Sizes.begin(), NonDefaultWorkers, DefaultGroupSz + 1);
+    std::fill_n(Sizes.begin(), NonDefaultWorkers,
+                static_cast<T>(DefaultGroupSz + 1));
     std::fill_n(Sizes.begin() + NonDefaultWorkers,
-                NumWorkers - NonDefaultWorkers, DefaultGroupSz);
+                NumWorkers - NonDefaultWorkers, static_cast<T>(DefaultGroupSz));
     return Sizes;
   }
 
-  template <class T = int> std::vector<T> getDisplacements() const {
+  template <class T = IndexT> std::vector<T> getDisplacements() const {
     std::vector<T> Displacements(NumWorkers); // {} must not be used here!
-    int DefaultGroupSz = WorkSz / NumWorkers;
+    IndexT DefaultGroupSz = WorkSz / NumWorkers;
     int NonDefaultWorkers = WorkSz % NumWorkers;
-    int Offset = 0;
+    IndexT Offset = 0;
     int WorkerId = 0;
     for (; WorkerId < NonDefaultWorkers; ++WorkerId) {
-      Displacements[WorkerId] = Offset;
+      Displacements[WorkerId] = static_cast<T>(Offset);
       Offset += DefaultGroupSz + 1;
     }
     for (; WorkerId < NumWorkers; ++WorkerId) {
-      Displacements[WorkerId] = Offset;
+      Displacements[WorkerId] = static_cast<T>(Offset);
       Offset += DefaultGroupSz;
     }
     return Displacements;
@@ -97,9 +106,18 @@ public:
     return isEvenlyDivided() ? MinSz : (MinSz + 1);
   }
 
+  IndexT getWorkSize() const { return WorkSz; }
+  int getNumWorkers() const { return NumWorkers; }
+
 private:
-  int WorkSz;
+  IndexT WorkSz;
   int NumWorkers;
 };
 
+using WorkRangeLinear = BasicWorkRangeLinear<int>;
+using WorkSplitterLinear = BasicWorkSplitterLinear<int>;
+
+using WorkRangeLinear64 = BasicWorkRangeLinear<long long>;
+using WorkSplitterLinear64 = BasicWorkSplitterLinear<long long>;
+
 } // namespace util
\ No newline at end of file
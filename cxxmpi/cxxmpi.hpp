@@ -10,6 +10,24 @@
 
 #include <mpi.h>
 #include "Shared/misc.hpp"
+#include "Shared/CartComm.hpp"
+#include "Shared/GridView.hpp"
+#include "Shared/AdaptStruct.hpp"
+#include "Shared/Serialization.hpp"
 #include "P2P/BlockingMessages.hpp"
+#include "P2P/NonblockingMessages.hpp"
+#include "P2P/PersistentMessages.hpp"
+#include "P2P/PackedMessages.hpp"
+#include "P2P/MessageAggregator.hpp"
 #include "Collective/CollectiveMessages.hpp"
+#include "Collective/Reduction.hpp"
+#include "Collective/AllToAll.hpp"
+#include "Collective/NonblockingCollectives.hpp"
+#include "Collective/CollectivePlans.hpp"
+#include "Collective/HierarchicalCollectives.hpp"
+#include "Collective/NeighborCollectives.hpp"
+#include "RMA/Window.hpp"
+#include "RMA/SharedWindow.hpp"
+#include "IO/File.hpp"
+#include "Support/DefaultInitAllocator.hpp"
 #include "Util/WorkSplitter.hpp"
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include "cxxmpi/cxxmpi.hpp"
 #include <iostream>
-#include <cassert>
+#include <vector>
 
 namespace mpi = cxxmpi;
 
@@ -21,29 +21,8 @@ bool operator==(const MyData &Fst, const MyData &Snd) {
 
 bool operator!=(const MyData &Fst, const MyData &Snd) { return !(Fst == Snd); }
 
-/* number of fields in MyData */
-#define NUMFIELDS 4
-
-MPI_Datatype createDatatypeForMyData() {
-  int BlockLengths[NUMFIELDS] = {1, 1, 1, 1};
-  MPI_Aint Displacements[NUMFIELDS] = {offsetof(MyData, C), offsetof(MyData, F),
-                                       offsetof(MyData, I1),
-                                       offsetof(MyData, I2)};
-  MPI_Datatype Types[NUMFIELDS] = {MPI_CHAR, MPI_FLOAT, MPI_INT, MPI_DOUBLE};
-  MPI_Datatype Type = MPI_DATATYPE_NULL;
-  (void)MPI_Type_create_struct(NUMFIELDS, BlockLengths, Displacements, Types, &Type);
-
-#ifndef NDEBUG
-  MPI_Aint Lb, Extent;
-  int Size;
-  (void)MPI_Type_get_extent(Type, &Lb, &Extent);
-  (void)MPI_Type_size(Type, &Size);
-  assert(Lb == 0);
-  assert(Extent == sizeof(MyData));
-#endif
-
-  return Type;
-}
+/* Fields are listed explicitly, MPI type is created on the first use */
+CXXMPI_ADAPT_STRUCT(MyData, C, F, I1, I2)
 
 int main(int argc, char *argv[]) {
   mpi::MPIContext Ctx{&argc, &argv};
@@ -54,21 +33,23 @@ int main(int argc, char *argv[]) {
   }
 
   MyData DataToSend{'!', 12.0, 3, 7};
-  MPI_Datatype Type = createDatatypeForMyData();
-  MPI_Type_commit(&Type);
+  /* arrays of structs are sent as a single message as well */
+  std::vector<MyData> ArrayToSend(3, DataToSend);
+  ArrayToSend[1].I1 = 42;
 
   if (mpi::commRank() == 0) {
-    MPI_Send(&DataToSend, 1, Type, 1, 0, MPI_COMM_WORLD);
+    mpi::send(DataToSend, 1);
+    mpi::send(ArrayToSend, 1);
   } else {
     MyData ReceivedData;
-    MPI_Recv(&ReceivedData, 1, Type, 0, 0, MPI_COMM_WORLD, nullptr);
-    if (ReceivedData != DataToSend) {
+    std::vector<MyData> ReceivedArray;
+    mpi::recv(ReceivedData, 0);
+    mpi::recv(ReceivedArray, 0);
+    if (ReceivedData != DataToSend || ReceivedArray != ArrayToSend) {
       std::cout << "Data corruption occured!!!" << std::endl;
       exit(EXIT_FAILURE);
     }
     std::cout << "Everything is correct" << std::endl;
   }
-  /* valid, but unnecessary */
-  //// MPI_Type_free(&Type);
   return 0;
 }
\ No newline at end of file
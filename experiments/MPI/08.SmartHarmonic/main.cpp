@@ -2,7 +2,6 @@
 #include "cxxmpi/cxxmpi.hpp"
 #include <iomanip>
 #include <iostream>
-#include <numeric>
 
 namespace mpi = cxxmpi;
 
@@ -24,11 +23,9 @@ int computeHarmonic(int N, bool VerboseModeEnabled) {
         WorkRange.LastIdx - 1, T.getElapsedTimeInSeconds(), Summ);
   }
 
-  if (auto GatherResult = mpi::gather(Summ)) {
-    auto Data = GatherResult.takeData();
-
+  if (auto ReduceResult = mpi::reduce(Summ)) {
     /* These is the result we wanted to compute */
-    double UltimateResult = std::accumulate(Data.begin(), Data.end(), 0.0);
+    double UltimateResult = ReduceResult.data();
     if (VerboseModeEnabled) {
       printf("I am manager, N = %d, ElapsedTime = %fs, Result = %lg\n", N,
              T.getElapsedTimeInSeconds(), UltimateResult);
@@ -36,8 +36,8 @@ void calculateGroup(int SeriesSize, unsigned int Precision) {
    mp::mpf_float PartialRes{mp::mpq_rational{Nominator, Denominator}, Precision};
    mp::mpf_float DenomRes{mp::mpq_rational{1, Denominator}, Precision};
 
-   mpi::send(PartialRes.str(), 0, /* tag = */ 0);
-   mpi::send(DenomRes.str(), 0, /* tag = */ 1);
+   /* both results go in a single message */
+   mpi::sendPacked(std::make_pair(PartialRes.str(), DenomRes.str()), 0);
 }
 
 int calculateExp(int Precision) {
@@ -53,16 +53,11 @@ int calculateExp(int Precision) {
    std::vector<mp::mpf_float> Partials(CommSz);
    std::vector<mp::mpf_float> Denoms(CommSz);
 
-   std::string Buf;
-   for (int I = 0; I < CommSz * 2; ++I) {
-      auto Status = mpi::recv(Buf);
-      if (Status.tag() == 0) {
-         Partials[Status.source()].assign(Buf);
-      } else {
-         assert(Status.tag() == 1);
-         Denoms[Status.source()].assign(Buf);
-      }
-      Buf.clear();
+   for (int I = 0; I < CommSz; ++I) {
+      std::pair<std::string, std::string> Res;
+      auto Status = mpi::recvPacked(Res);
+      Partials[Status.source()].assign(Res.first);
+      Denoms[Status.source()].assign(Res.second);
    }
 
    /* reduce */
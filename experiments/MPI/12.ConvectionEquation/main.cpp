@@ -130,28 +130,21 @@ mpi::GatherResult<double> compute(double X, double T, int M, int K, PhiTy &&Phi,
 
   /* 5. Prepare to run cross scheme */
   /* elems feteched from the left and right neighbors */
-  double LeftNeighbor = 0;
-  double RightNeighbor = 0;
-
-  /* using MPI_PROC_NULL feature */
-  auto RightRank = RightNeighborExists ? (Rank + 1) : MPI_PROC_NULL;
-  auto LeftRank = LeftNeighborExists ? (Rank - 1) : MPI_PROC_NULL;
-
-  /* sends Cur.back() to the right neighbor, Cur.front() to the left neighbor
-   * and fetch LeftNeighbor, RightNeighbor from the left and right neighbor
-   * A trick is done to avoid deadlock */
+  double Halo[2] = {0, 0};
+  double &LeftNeighbor = Halo[0];
+  double &RightNeighbor = Halo[1];
+
+  /* Segments follow ranks in MPI_COMM_WORLD, so ranks are not reordered.
+   * Missing neighbors at the ends of X axis are MPI_PROC_NULL, exchange with
+   * them is a no-op */
+  auto Line = mpi::CartComm::grid(1, /* periodic */ false, MPI_COMM_WORLD,
+                                  /* reorder */ false);
+
+  /* sends Cur.front() to the left neighbor, Cur.back() to the right neighbor
+   * and fetch LeftNeighbor, RightNeighbor from the left and right neighbor */
   auto doMsgExchange = [&]() {
-    if (Rank % 2 == 0) {
-      mpi::send(Cur.back(), RightRank);
-      mpi::send(Cur.front(), LeftRank);
-      mpi::recv(LeftNeighbor, LeftRank);
-      mpi::recv(RightNeighbor, RightRank);
-    } else {
-      mpi::recv(LeftNeighbor, LeftRank);
-      mpi::recv(RightNeighbor, RightRank);
-      mpi::send(Cur.back(), RightRank);
-      mpi::send(Cur.front(), LeftRank);
-    }
+    double Border[2] = {Cur.front(), Cur.back()};
+    mpi::neighborAlltoall<double>(Border, Halo, Line);
   };
 
   /* 6. Exchange corner elements of the 1-st row between segments */
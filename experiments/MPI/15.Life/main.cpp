@@ -97,6 +97,13 @@ public:
 
   std::vector<Cell> extractRow(size_t Idx) const { return extractRows(Idx, Idx + 1); }
 
+  /* View rows in range [Fst; Last) without copying */
+  cxxmpi::ArrayRef<Cell> rows(size_t Fst, size_t Last) const {
+    return cxxmpi::ArrayRef<Cell>(Data).slice(Fst * getWidth(),
+                                              (Last - Fst) * getWidth());
+  }
+  cxxmpi::ArrayRef<Cell> row(size_t Idx) const { return rows(Idx, Idx + 1); }
+
   void readFromFile(const std::string &Path) {
     std::ifstream Is{Path};
     if (!Is.is_open())
@@ -151,6 +158,8 @@ bool ViewUpdateAvail = false;
 
 /* Part of global map on which MPI executor is working */
 GameMap LocalMap;
+/* Layout of local maps never changes after scatter */
+cxxmpi::GathervPlan MapGatherPlan;
 
 void drawMap(sf::RenderTarget &Target, const GameMap &Map) {
   if (Map.empty())
@@ -347,8 +356,7 @@ void mpiScatterGameMap() {
 
     for (unsigned I = 1; I < WorkerCount; ++I) {
       auto Rows = Splitter.getRange(I);
-      auto Data = MapToSend.extractRows(Rows.FirstIdx, Rows.LastIdx);
-      cxxmpi::send(Data, I);
+      cxxmpi::send(MapToSend.rows(Rows.FirstIdx, Rows.LastIdx), I);
     }
     auto Rows = Splitter.getRange(0);
     LocalMap.init(MapToSend.extractRows(Rows.FirstIdx, Rows.LastIdx), MapWidth);
@@ -357,6 +365,7 @@ void mpiScatterGameMap() {
     cxxmpi::recv(Buf, 0);
     LocalMap.init(std::move(Buf), MapWidth);
   }
+  MapGatherPlan = cxxmpi::GathervPlan::fromLocalSize(LocalMap.buf().size(), 0);
   std::cout << cxxmpi::whoami << ": init local map " << LocalMap.getWidth()
             << " x " << LocalMap.getHeight() << std::endl;
   dumpMap(LocalMap);
@@ -365,48 +374,35 @@ void mpiScatterGameMap() {
 /* Receive local maps from MPI executors and put them into GlobalMap on root */
 void mpiGatherGameMap() {
   // std::cout << cxxmpi::whoami << ": gather" << std::endl;
-  if (auto Res = cxxmpi::gatherv(LocalMap.buf())) {
+  std::vector<Cell> Buf;
+  if (MapGatherPlan.gather(LocalMap.buf(), Buf)) {
     std::lock_guard<std::mutex> Lock{GlobalAccess};
-    GlobalMap.init(Res.takeData(), LocalMap.getWidth());
+    GlobalMap.init(std::move(Buf), LocalMap.getWidth());
     ViewUpdateAvail = true;
   }
 }
 
 void mpiStep() {
   dbg() << cxxmpi::whoami << ": step" << std::endl;
-  const auto CommRank = cxxmpi::commRank();
-  const auto CommSize = cxxmpi::commSize();
-  /* Lower = lower index, Higher = higher index */
-  const auto LowerNeighbor = (CommRank + CommSize - 1) % CommSize;
-  const auto UpperNeighbor = (CommRank + 1) % CommSize;
+  /* Map is split between executors by their ranks in MPI_COMM_WORLD, so
+   * the ring must not reorder them */
+  static const auto Ring =
+      cxxmpi::CartComm::grid(1, /* periodic */ true, MPI_COMM_WORLD, false);
   const auto MapWidth = LocalMap.getWidth();
 
-  const auto extractLowerRow = [](const GameMap &Map) {
-    return Map.extractRow(0);
-  };
-  const auto extractUpperRow = [](const GameMap &Map) {
-    return Map.extractRow(Map.getHeight() - 1);
-  };
-
-  std::vector<Cell> LowerRow;
-  std::vector<Cell> UpperRow;
-
-  if (cxxmpi::commSize() > 1) {
-    if (cxxmpi::commRank() % 2 == 0) {
-      cxxmpi::send(extractLowerRow(LocalMap), LowerNeighbor);
-      cxxmpi::send(extractUpperRow(LocalMap), UpperNeighbor);
-      cxxmpi::recv(UpperRow, UpperNeighbor);
-      cxxmpi::recv(LowerRow, LowerNeighbor);
-    } else {
-      cxxmpi::recv(UpperRow, UpperNeighbor);
-      cxxmpi::recv(LowerRow, LowerNeighbor);
-      cxxmpi::send(extractLowerRow(LocalMap), LowerNeighbor);
-      cxxmpi::send(extractUpperRow(LocalMap), UpperNeighbor);
-    }
-  } else {
-    LowerRow = extractUpperRow(LocalMap);
-    UpperRow = extractLowerRow(LocalMap);
-  }
+  /* Lower neighbor (lower index) gets our lower row and sends its upper row
+   * in return, and vice versa. Single executor is its own neighbor */
+  const int Width = MapWidth;
+  const int Height = LocalMap.getHeight();
+  const int Counts[] = {Width, Width};
+  const int SendDispls[] = {0, (Height - 1) * Width};
+  const int RecvDispls[] = {0, Width};
+  std::vector<Cell> Halo(2 * MapWidth);
+  cxxmpi::neighborAlltoallv<Cell>(LocalMap.buf(), Counts, SendDispls,
+                                  cxxmpi::makeMutableArrayRef(Halo), Counts,
+                                  RecvDispls, Ring);
+  std::vector<Cell> LowerRow(Halo.begin(), Halo.begin() + MapWidth);
+  std::vector<Cell> UpperRow(Halo.begin() + MapWidth, Halo.end());
 
   GameMap Map;
   Map.append(LowerRow);
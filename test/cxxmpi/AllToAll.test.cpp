@@ -0,0 +1,19 @@
+#include <catch2/catch_all.hpp>
+#include "cxxmpi/cxxmpi.hpp"
+
+#include <vector>
+
+TEST_CASE("AlltoallvLayout::redistribution()", "[AllToAll]") {
+  /* [0, 4), [4, 7), [7, 10) -> [0, 5), [5, 10), [] */
+  util::WorkSplitterLinear From{10, 3};
+  util::WorkSplitterLinear To{10, 2};
+  auto Layout = cxxmpi::AlltoallvLayout::redistribution(From, To, 1, 3);
+  CHECK(Layout.send_counts == std::vector<int>{1, 2, 0});
+  CHECK(Layout.send_displs == std::vector<int>{0, 1, 3});
+  CHECK(Layout.recv_counts == std::vector<int>{0, 2, 3});
+  CHECK(Layout.recv_displs == std::vector<int>{0, 0, 2});
+
+  Layout = cxxmpi::AlltoallvLayout::redistribution(From, To, 2, 3);
+  CHECK(Layout.send_counts == std::vector<int>{0, 3, 0});
+  CHECK(Layout.getRecvSize() == 0);
+}
@@ -0,0 +1,28 @@
+#include <catch2/catch_all.hpp>
+#include "cxxmpi/cxxmpi.hpp"
+
+#include <numeric>
+#include <vector>
+
+TEST_CASE("GridView blocks", "[GridView]") {
+  std::vector<int> Data(4 * 5);
+  std::iota(Data.begin(), Data.end(), 0);
+  auto Grid = cxxmpi::makeGridView(Data, 5);
+  CHECK(Grid.getNumRows() == 4);
+  CHECK(Grid.isContiguous());
+  CHECK(Grid(2, 3) == 13);
+
+  auto Block = Grid.block(1, 2, 2, 3);
+  CHECK(Block.getStride() == 5);
+  CHECK(!Block.isContiguous());
+  CHECK(Block(0, 0) == 7);
+  CHECK(Block(1, 2) == 14);
+
+  auto Col = Block.column(1);
+  CHECK(Col.getNumRows() == 2);
+  CHECK(Col(1, 0) == 13);
+  CHECK(Block.row(1).isContiguous());
+
+  cxxmpi::GridView<const int> ConstCol = Col;
+  CHECK(ConstCol.data() == &Data[8]);
+}
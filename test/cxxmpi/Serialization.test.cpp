@@ -0,0 +1,52 @@
+#include <catch2/catch_all.hpp>
+#include "cxxmpi/cxxmpi.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct Record {
+  std::string Name;
+  std::vector<double> Values;
+  int Id;
+};
+
+CXXMPI_SERIALIZABLE_STRUCT(Record, Name, Values, Id)
+
+TEST_CASE("pack()/unpack() of nested containers", "[Serialization]") {
+  std::map<std::string, std::vector<std::vector<int>>> Obj;
+  Obj["empty"];
+  Obj["one"] = {{1}};
+  Obj["jagged"] = {{1, 2, 3}, {}, {4, 5}};
+
+  auto Bytes = cxxmpi::pack(Obj);
+  CHECK(cxxmpi::unpack<decltype(Obj)>(Bytes) == Obj);
+}
+
+TEST_CASE("pack() uses compact size headers", "[Serialization]") {
+  CHECK(cxxmpi::pack(std::string{"abc"}).size() == 1 + 3);
+  CHECK(cxxmpi::pack(std::string(200, 'x')).size() == 2 + 200);
+  CHECK(cxxmpi::pack(std::vector<int>(5)).size() == 1 + 5 * sizeof(int));
+}
+
+TEST_CASE("pack()/unpack() of CXXMPI_SERIALIZABLE_STRUCT", "[Serialization]") {
+  std::vector<Record> Records{{"first", {1.5, 2.5}, 1}, {"", {}, 2}};
+  std::pair<bool, std::vector<bool>> Flags{true, {false, true, true}};
+
+  cxxmpi::Buffer<char> Bytes;
+  cxxmpi::pack(Records, Bytes);
+  cxxmpi::pack(Flags, Bytes);
+
+  cxxmpi::Unpacker U{Bytes};
+  std::vector<Record> RecordsCopy;
+  std::pair<bool, std::vector<bool>> FlagsCopy;
+  cxxmpi::Serializer<std::vector<Record>>::unpack(U, RecordsCopy);
+  cxxmpi::Serializer<decltype(Flags)>::unpack(U, FlagsCopy);
+  CHECK(U.remaining() == 0);
+
+  REQUIRE(RecordsCopy.size() == 2);
+  CHECK(RecordsCopy[0].Name == "first");
+  CHECK(RecordsCopy[0].Values == std::vector<double>{1.5, 2.5});
+  CHECK(RecordsCopy[1].Id == 2);
+  CHECK(FlagsCopy == Flags);
+}
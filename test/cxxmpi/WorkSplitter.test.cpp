@@ -27,4 +27,20 @@ TEST_CASE("WorkSplitterLinear::getDisplacements()", "[Util]") {
   CHECK(Displs.size() == 4);
   int ExpectedDispls[] = {0, 3, 6, 9};
   CHECK(std::equal(Displs.begin(), Displs.end(), ExpectedDispls));
-}
\ No newline at end of file
+}
+
+TEST_CASE("WorkSplitterLinear64 handles work sizes above INT_MAX", "[Util]") {
+  const long long WorkSz = 5000000000LL;
+  util::WorkSplitterLinear64 S{WorkSz, 3};
+  CHECK(S.getRange(0).FirstIdx == 0);
+  CHECK(S.getRange(0).LastIdx == 1666666667LL);
+  CHECK(S.getRange(1).LastIdx == 3333333334LL);
+  CHECK(S.getRange(2).FirstIdx == 3333333334LL);
+  CHECK(S.getRange(2).LastIdx == WorkSz);
+  auto Sizes = S.getSizes();
+  long long ExpectedSizes[] = {1666666667LL, 1666666667LL, 1666666666LL};
+  CHECK(std::equal(Sizes.begin(), Sizes.end(), ExpectedSizes));
+  auto Displs = S.getDisplacements();
+  CHECK(Displs.back() == 3333333334LL);
+  CHECK(S.getMaxWorkSize() == 1666666667U);
+}